@@ -0,0 +1,100 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * AggregatorTest.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file AggregatorTest.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Check InfluxAggregator with out of order and non-finite samples.
+ * @details Samples for one series arrive out of order within a window, late for a superseded window, and
+ * late for a window already closed by flush(). Every window must be written once with only its own samples,
+ * the open window must not be written early, and every late sample must be counted. NaN and infinite
+ * samples must be counted and left out of their window.
+ */
+
+#include <iostream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "BetterMain/BMain.h"
+#include "Influx/InfluxAggregator.h"
+
+namespace {
+
+    constexpr unsigned long long Second = 1000000000ULL;
+
+    int failures = 0;
+
+    void expect(bool condition, std::string_view what) {
+        if (!condition) {
+            std::cerr << "Failed: " << what << '\n';
+            ++failures;
+        }
+    }
+
+    std::vector<std::string> lines(InfluxLineBuffer &buffer) {
+        std::vector<std::string> result{};
+        std::string_view view{buffer.view()};
+        for (auto end = view.find('\n'); end != std::string_view::npos; end = view.find('\n')) {
+            result.emplace_back(view.substr(0, end));
+            view.remove_prefix(end + 1);
+        }
+        buffer.clear();
+        return result;
+    }
+}
+
+namespace better_main {
+    [[nodiscard]] int start(std::span<const std::string_view>) noexcept {
+        InfluxAggregator aggregator{std::chrono::seconds{1}, 4};
+        InfluxLineBuffer out{};
+
+        // Out of order within window 10.
+        aggregator.add("m ", "v", 3.0, 10 * Second + 500);
+        aggregator.add("m ", "v", 1.0, 10 * Second + 100);
+        aggregator.add("m ", "v", 2.0, 10 * Second + 900);
+        // Window 11 supersedes window 10, a sample for window 10 is then late.
+        aggregator.add("m ", "v", 5.0, 11 * Second + 200);
+        aggregator.add("m ", "v", 7.0, 10 * Second + 999);
+
+        aggregator.flush(out, 11 * Second + 300);
+        auto closed = lines(out);
+        expect(closed.size() == 1, "one window closed after window 11 opened");
+        if (!closed.empty())
+            expect(closed[0] == "m v_min=1,v_max=3,v_mean=2,v_count=3i 10000000000",
+                   "window 10 holds only its own samples");
+        expect(aggregator.lateSamples() == 1, "the sample for superseded window 10 is counted");
+
+        // Window 11 is closed by flush, a later sample for it is late and must not reopen it.
+        aggregator.flush(out, 12 * Second);
+        aggregator.add("m ", "v", 9.0, 11 * Second + 800);
+        aggregator.add("m ", "v", 4.0, 12 * Second + 100);
+        aggregator.add("m ", "v", 6.0, 9 * Second);
+        aggregator.add("m ", "v", std::numeric_limits<double>::quiet_NaN(), 12 * Second + 200);
+        aggregator.add("m ", "v", -std::numeric_limits<double>::infinity(), 12 * Second + 300);
+        aggregator.flush(out, 12 * Second + 500);
+        closed = lines(out);
+        expect(closed.size() == 1, "only window 11 closed, window 12 is still open");
+        if (!closed.empty())
+            expect(closed[0] == "m v_min=5,v_max=5,v_mean=5,v_count=1i 11000000000",
+                   "window 11 is written once without the late sample");
+        expect(aggregator.lateSamples() == 3, "samples for closed windows are counted");
+        expect(aggregator.nonFiniteSamples() == 2, "non-finite samples are counted");
+
+        aggregator.flushAll(out);
+        closed = lines(out);
+        expect(closed.size() == 1 && closed[0] == "m v_min=4,v_max=4,v_mean=4,v_count=1i 12000000000",
+               "window 12 is written by flushAll without the non-finite samples");
+
+        std::cout << (failures ? "FAIL" : "PASS")
+                  << ": aggregator windows with out of order and non-finite samples.\n";
+        return failures ? 1 : 0;
+    }
+}
@@ -3,6 +3,7 @@
 //
 
 #include "BetterMain/BMain.h"
+#include "BetterMain/BMainHelp.h"
 #include <iostream>
 #include <algorithm>
 #include <fstream>
@@ -14,6 +15,7 @@ enum class ArgIdx : size_t {
     ExecName,
     User,
     Group,
+    Man,
     ArgCount
 };
 
@@ -24,11 +26,20 @@ namespace better_main {
         { ArgIdx::ExecName, ArgType::String, 'e', "execName", "Specify the executable to generate for.", ""},
         { ArgIdx::Output, ArgType::Path, 'o', "output", "Specify the output file.", ""},
         { ArgIdx::User, ArgType::User, 'u', "user" "", "" },
-        { ArgIdx::Group, ArgType::Group, 'g', "group", "", ""}
+        { ArgIdx::Group, ArgType::Group, 'g', "group", "", ""},
+        { ArgIdx::Man, ArgType::NoValue, 'm', "man", "Generate a man page instead of a completion file.", ""}
     }};
 
     [[nodiscard]] int start(std::span<const std::string_view> args) noexcept {
-        auto invocation = parseArgs(args, ProgramArgs, false);
+        auto parsed = parseArgs(args, ProgramArgs, std::nothrow, false);
+        if (!parsed) {
+            std::cerr << parsed.error().message() << '\n';
+            return 1;
+        }
+        auto &invocation = *parsed;
+        if (Help<ProgramArgs, false>::print(invocation))
+            return 0;
+
         for (const auto& arg : invocation) {
             if (arg.argType == ArgType::FreeArg)
                 std::cout << "\tFree arg: '" << arg.value << "'\n";
@@ -41,7 +52,10 @@ namespace better_main {
         if (auto execName = findArgument(invocation, ArgIdx::ExecName); execName.has_value()) {
             if (auto output = findArgument(invocation, ArgIdx::Output); output.has_value()) {
                 std::ofstream fStr{output.value().value};
-                generateCompletionFile(execName.value().value, ProgramArgs, fStr, false);
+                if (findArgument(invocation, ArgIdx::Man))
+                    generateManPage(execName.value().value, "better_main example program", ProgramArgs, fStr, 1, false);
+                else
+                    generateCompletionFile(execName.value().value, ProgramArgs, fStr, false);
                 fStr.close();
             } else {
                 std::cerr << "Output file required.\n";
@@ -0,0 +1,67 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * AggregatorBench.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file AggregatorBench.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Measure InfluxAggregator ingest with 100k active series.
+ * @details Samples are spread round robin over the series with time advancing so each series sees ten
+ * samples per one second window. The case is compared with writing every sample as a line.
+ */
+
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+#include "../Influx/InfluxAggregator.h"
+
+namespace {
+    constexpr std::size_t Series = 100000;
+    constexpr unsigned long long TimeStamp{1700000000000000000ULL};
+    constexpr unsigned long long SampleInterval{1000000000ULL / 10 / Series};
+
+    const std::vector<std::string> &prefixes() {
+        static const std::vector<std::string> values = [] {
+            std::vector<std::string> list{};
+            for (std::size_t i = 0; i < Series; ++i)
+                list.push_back(ysh::StringComposite("sensor,id=", i, ' '));
+            return list;
+        }();
+        return values;
+    }
+
+    bench::Registrar aggregator{"influx.InfluxAggregator.add 100k series", 10000000, [](std::size_t n) {
+        const auto &prefix = prefixes();
+        InfluxAggregator aggregator{std::chrono::seconds{1}, Series};
+        InfluxLineBuffer out{};
+        for (std::size_t i = 0; i < n; ++i) {
+            auto timeStamp = TimeStamp + i * SampleInterval;
+            aggregator.add(prefix[i % Series], "value", static_cast<double>(i % 1000), timeStamp);
+            if (i % Series == Series - 1) {
+                aggregator.flush(out, timeStamp);
+                out.clear();
+            }
+        }
+        bench::report("bytes/series", static_cast<double>(aggregator.memoryUsage())
+                                      / static_cast<double>(aggregator.seriesCount()));
+        return n;
+    }};
+
+    bench::Registrar lines{"influx.InfluxLineBuffer.add 100k series", 10000000, [](std::size_t n) {
+        const auto &prefix = prefixes();
+        InfluxLineBuffer out{};
+        for (std::size_t i = 0; i < n; ++i) {
+            out.add(prefix[i % Series], "value", static_cast<double>(i % 1000), TimeStamp + i * SampleInterval);
+            if (i % Series == Series - 1)
+                out.clear();
+        }
+        bench::doNotOptimize(out.size());
+        return n;
+    }};
+}
@@ -0,0 +1,196 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * BMainBench.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file BMainBench.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Measure command line parsing at scale.
+ * @details A 32 option specification parses a 1000 token command line. InputParser answers 32 queries on
+ * the same command line. A bad command line is rejected by the throwing parseArgs() and by the std::nothrow
+ * overload, to show the cost of unwinding.
+ *
+ * The invocation cases run this program, with a filter that matches no case, as a child process and wait
+ * for it. Cold is a normal start. Warm sets better_main::ResidentEnvVar, so start() runs in the resident
+ * server and the child only loads, hands over and waits. The server is started, and XDG_RUNTIME_DIR made
+ * if it is not set, before timing.
+ */
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <array>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include <StringArena.h>
+#include "BMain.h"
+#include "Benchmark.h"
+#include "../InputParser.h"
+
+namespace {
+    constexpr std::size_t OptionCount = 32;
+    constexpr std::size_t TokenCount = 1000;
+
+    enum class BenchArg : std::size_t {
+        FreeArg,
+        First,
+        Last = First + OptionCount - 1,
+    };
+
+    constexpr std::array<std::string_view, OptionCount> LongNames{
+            "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel", "india", "juliett", "kilo",
+            "lima", "mike", "november", "oscar", "papa", "quebec", "romeo", "sierra", "tango", "uniform", "victor",
+            "whiskey", "xray", "yankee", "zulu", "one", "two", "three", "four", "five", "six"};
+
+    constexpr auto Spec = [] {
+        std::array<better_main::BMainArg<BenchArg>, OptionCount + 1> spec{};
+        spec[0] = {BenchArg::FreeArg, better_main::ArgType::FreeArg, '\0', "", "", ""};
+        for (std::size_t idx = 0; idx < OptionCount; ++idx)
+            spec[idx + 1] = {static_cast<BenchArg>(idx + 1),
+                             idx % 2 ? better_main::ArgType::String : better_main::ArgType::NoValue,
+                             static_cast<char>(idx < 26 ? 'a' + idx : 'A' + idx - 26), LongNames[idx], "", ""};
+        return spec;
+    }();
+
+    /**
+     * @brief A command line of long options, values and free arguments.
+     */
+    const std::vector<std::string> &commandLine() {
+        static const std::vector<std::string> tokens = [] {
+            std::vector<std::string> list{"program"};
+            for (std::size_t idx = 0; list.size() < TokenCount; ++idx) {
+                auto option = idx % OptionCount;
+                list.push_back(ysh::StringComposite("--", LongNames[option]));
+                if (option % 2)
+                    list.push_back(ysh::StringComposite("value", idx));
+                if (idx % 5 == 0)
+                    list.push_back(ysh::StringComposite("free", idx));
+            }
+            return list;
+        }();
+        return tokens;
+    }
+
+    bench::Registrar parseArgs{"bmain.parseArgs 1000 tokens", 2000, [](std::size_t n) {
+        std::vector<std::string_view> views(commandLine().begin(), commandLine().end());
+        for (std::size_t i = 0; i < n; ++i) {
+            std::span<const std::string_view> args{views};
+            bench::doNotOptimize(better_main::parseArgs(args, Spec).size());
+        }
+        return n;
+    }};
+
+    bench::Registrar parseError{"bmain.parseArgs error throw", 100000, [](std::size_t n) {
+        static constexpr std::array<std::string_view, 3> views{"bench", "--alpha", "--unknown"};
+        for (std::size_t i = 0; i < n; ++i) {
+            std::span<const std::string_view> args{views};
+            try {
+                bench::doNotOptimize(better_main::parseArgs(args, Spec).size());
+            } catch (const better_main::ArgParseError &e) {
+                bench::doNotOptimize(e.what());
+            }
+        }
+        return n;
+    }};
+
+    bench::Registrar parseErrorExpected{"bmain.parseArgs error expected", 100000, [](std::size_t n) {
+        static constexpr std::array<std::string_view, 3> views{"bench", "--alpha", "--unknown"};
+        for (std::size_t i = 0; i < n; ++i) {
+            std::span<const std::string_view> args{views};
+            auto invocation = better_main::parseArgs(args, Spec, std::nothrow);
+            bench::doNotOptimize(invocation.has_value() ? invocation->size() : invocation.error().tokenIndex);
+        }
+        return n;
+    }};
+
+    bench::Registrar inputParser{"bmain.InputParser 32 queries 1000 tokens", 20000, [](std::size_t n) {
+        std::vector<const char *> argv{};
+        for (const auto &token : commandLine())
+            argv.push_back(token.c_str());
+        for (std::size_t i = 0; i < n; ++i) {
+            InputParser parser{static_cast<int>(argv.size()), argv.data()};
+            std::size_t found = 0;
+            for (auto name : LongNames)
+                found += parser.option(ysh::StringArena::local().composite("--", name)).has_value();
+            ysh::StringArena::local().reset();
+            bench::doNotOptimize(found);
+        }
+        return n;
+    }};
+
+    /**
+     * @class Invoker
+     * @brief Run this program as a child process with a chosen environment.
+     */
+    class Invoker {
+    private:
+        std::string mProgram{std::filesystem::read_symlink("/proc/self/exe")};
+        std::vector<std::string> mEnvironment{};
+
+    public:
+        explicit Invoker(bool resident) {
+            for (auto env = environ; *env; ++env)
+                if (!std::string_view{*env}.starts_with(better_main::ResidentEnvVar))
+                    mEnvironment.emplace_back(*env);
+            if (!resident)
+                return;
+            mEnvironment.push_back(ysh::StringComposite(better_main::ResidentEnvVar, "=2"));
+            if (getenv("XDG_RUNTIME_DIR") == nullptr) {
+                auto runtimeDir = std::filesystem::temp_directory_path() / ysh::StringComposite("bench-runtime-", getuid());
+                mkdir(runtimeDir.c_str(), 0700);
+                mEnvironment.push_back(ysh::StringComposite("XDG_RUNTIME_DIR=", runtimeDir));
+            }
+        }
+
+        int operator()() const {
+            std::vector<char *> argv{const_cast<char *>(mProgram.c_str()), const_cast<char *>("-f"),
+                                     const_cast<char *>("no such case"), nullptr};
+            std::vector<char *> envp{};
+            for (const auto &env : mEnvironment)
+                envp.push_back(const_cast<char *>(env.c_str()));
+            envp.push_back(nullptr);
+            posix_spawn_file_actions_t actions{};
+            posix_spawn_file_actions_init(&actions);
+            posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+            pid_t child{};
+            int status{-1};
+            if (posix_spawn(&child, mProgram.c_str(), &actions, nullptr, argv.data(), envp.data()) == 0)
+                waitpid(child, &status, 0);
+            posix_spawn_file_actions_destroy(&actions);
+            return status;
+        }
+    };
+
+    bench::Registrar coldInvocation{"bmain.invocation cold", 200, [](std::size_t n) {
+        static const Invoker invoke{false};
+        for (std::size_t i = 0; i < n; ++i)
+            bench::doNotOptimize(invoke());
+        return n;
+    }};
+
+    bench::Registrar warmInvocation{"bmain.invocation warm", 200, [](std::size_t n) {
+        static const Invoker invoke{true};
+        // The first run starts the server in the background, the second may not find it yet.
+        static const bool started = [] {
+            for (int attempt = 0; attempt < 4; ++attempt) {
+                invoke();
+                std::this_thread::sleep_for(std::chrono::milliseconds{50});
+            }
+            return true;
+        }();
+        bench::doNotOptimize(started);
+        for (std::size_t i = 0; i < n; ++i)
+            bench::doNotOptimize(invoke());
+        return n;
+    }};
+}
@@ -0,0 +1,167 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * Benchmark.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file Benchmark.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @details Options select the cases to run by name, the number of repetitions of each, and a JSON file to
+ * write the results to so runs on different commits can be compared. With repetitions the median time is
+ * reported along with the fastest.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include "BMain.h"
+#include "BMainHelp.h"
+#include "Benchmark.h"
+
+enum class ArgIdx : size_t {
+    FreeArg,
+    Help,
+    Filter,
+    Repeat,
+    Json,
+    List,
+    ArgCount
+};
+
+namespace bench {
+    std::vector<Case> &registry() {
+        static std::vector<Case> cases{};
+        return cases;
+    }
+
+    /**
+     * @brief Repeat a case and summarize the repetitions.
+     * @return The repetition with the median time, with nsPerOpMin set to the fastest time.
+     */
+    Result repeat(const Case &benchCase, std::size_t repetitions) {
+        std::vector<Result> results{};
+        for (std::size_t rep = 0; rep < std::max(repetitions, std::size_t{1}); ++rep)
+            results.push_back(run(benchCase));
+        std::sort(results.begin(), results.end(), [](const Result &a, const Result &b) {
+            return a.nsPerOp < b.nsPerOp;
+        });
+        auto median = results[results.size() / 2];
+        median.nsPerOpMin = results.front().nsPerOp;
+        median.repetitions = results.size();
+        return median;
+    }
+
+    /**
+     * @brief Write a string as a JSON string literal.
+     */
+    void jsonString(std::ostream &out, std::string_view text) {
+        out << '"';
+        for (auto c : text) {
+            if (c == '"' || c == '\\')
+                out << '\\' << c;
+            else if (static_cast<unsigned char>(c) < 0x20)
+                out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c)
+                    << std::dec << std::setfill(' ');
+            else
+                out << c;
+        }
+        out << '"';
+    }
+
+    void writeJson(std::ostream &out, const std::vector<Result> &results) {
+        out << std::setprecision(6) << "{\n  \"results\": [";
+        for (std::size_t idx = 0; idx < results.size(); ++idx) {
+            const auto &result = results[idx];
+            out << (idx ? ",\n" : "\n") << "    {\"name\": ";
+            jsonString(out, result.name);
+            out << ", \"iterations\": " << result.iterations << ", \"repetitions\": " << result.repetitions
+                << ", \"ns_per_op\": " << result.nsPerOp << ", \"ns_per_op_min\": " << result.nsPerOpMin
+                << ", \"allocs_per_op\": " << result.allocsPerOp;
+            for (const auto &[name, value] : result.counters) {
+                out << ", ";
+                jsonString(out, name);
+                out << ": " << value;
+            }
+            out << '}';
+        }
+        out << "\n  ]\n}\n";
+    }
+} // bench
+
+namespace better_main {
+    static constexpr std::array<better_main::BMainArg<ArgIdx>,static_cast<size_t>(ArgIdx::ArgCount)> ProgramArgs = {{
+        { ArgIdx::FreeArg, ArgType::FreeArg, '\0', "", "", ""},
+        { ArgIdx::Help, ArgType::Help, 'h', "help", "Display program or option help.", ""},
+        { ArgIdx::Filter, ArgType::String, 'f', "filter", "Run only cases whose name contains the text.", ""},
+        { ArgIdx::Repeat, ArgType::Integer, 'r', "repeat", "Run each case this many times, default 1.", ""},
+        { ArgIdx::Json, ArgType::Path, 'j', "json", "Write the results to a JSON file, - for stdout.", ""},
+        { ArgIdx::List, ArgType::NoValue, 'l', "list", "List the case names.", ""},
+    }};
+
+    [[nodiscard]] int start(std::span<const std::string_view> args) noexcept {
+        try {
+            auto invocation = parseArgs(args, ProgramArgs);
+            if (Help<ProgramArgs>::print(invocation))
+                return 0;
+
+            std::vector<std::string> filters{};
+            for (const auto &arg : invocation)
+                if (arg.argIdx == ArgIdx::Filter)
+                    filters.push_back(arg.value);
+            std::size_t repetitions = 1;
+            if (auto repeat = findArgument(invocation, ArgIdx::Repeat))
+                repetitions = numericValue<unsigned long>(repeat->value).value;
+            auto json = findArgument(invocation, ArgIdx::Json);
+            auto toStdout = json && json->value == "-";
+
+            std::vector<bench::Result> results{};
+            for (const auto &benchCase : bench::registry()) {
+                if (!filters.empty() && std::none_of(filters.begin(), filters.end(), [&benchCase](const auto &filter) {
+                    return benchCase.name.find(filter) != std::string_view::npos;
+                }))
+                    continue;
+                if (findArgument(invocation, ArgIdx::List)) {
+                    std::cout << benchCase.name << '\n';
+                    continue;
+                }
+
+                auto result = bench::repeat(benchCase, repetitions);
+                auto &out = toStdout ? std::cerr : std::cout;
+                out << std::left << std::setw(48) << result.name
+                    << std::right << std::setw(12) << result.iterations
+                    << std::setw(14) << std::fixed << std::setprecision(2) << result.nsPerOp << " ns/op"
+                    << std::setw(10) << (result.nsPerOp > 0.0 ? 1000.0 / result.nsPerOp : 0.0) << " Mops/s"
+                    << std::setw(10) << result.allocsPerOp << " allocs/op";
+                if (result.repetitions > 1)
+                    out << " min=" << result.nsPerOpMin;
+                for (const auto &[name, value] : result.counters)
+                    out << ' ' << name << '=' << value;
+                out << std::endl;
+                results.push_back(std::move(result));
+            }
+
+            if (json) {
+                if (toStdout) {
+                    bench::writeJson(std::cout, results);
+                } else {
+                    std::ofstream out{json->value};
+                    bench::writeJson(out, results);
+                    if (!out) {
+                        std::cerr << "Unable to write " << json->value << '\n';
+                        return 1;
+                    }
+                }
+            }
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << '\n';
+            return 1;
+        }
+        return 0;
+    }
+}
@@ -0,0 +1,112 @@
+/*
+ * Benchmark.h Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file Benchmark.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief A minimal micro benchmark harness.
+ * @details Each subsystem registers its cases from its own translation unit with a static Registrar. The
+ * Benchmark program runs the registered cases and reports the time per operation.
+ */
+
+#ifndef VE3YSH_UTIL_BENCHMARK_H
+#define VE3YSH_UTIL_BENCHMARK_H
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "../ysh/AllocationCounter.h"
+
+namespace bench {
+
+    /**
+     * @struct Result
+     * @brief The outcome of one benchmark case.
+     */
+    struct Result {
+        std::string name{};             ///< The case name.
+        std::size_t iterations{};       ///< The number of operations timed.
+        double nsPerOp{};               ///< Mean wall clock nanoseconds per operation.
+        double nsPerOpMin{};            ///< The fastest repetition, when repeated.
+        std::size_t repetitions{1};     ///< The number of times the case was run.
+        double allocsPerOp{};           ///< Mean heap allocations per operation.
+        std::vector<std::pair<std::string, double>> counters{};     ///< Values reported by the case.
+    };
+
+    /**
+     * @brief The values reported by the running case.
+     */
+    inline std::vector<std::pair<std::string, double>> &counters() {
+        static std::vector<std::pair<std::string, double>> values{};
+        return values;
+    }
+
+    /**
+     * @brief Report a value, other than time and allocations, from the running case.
+     */
+    inline void report(std::string name, double value) {
+        counters().emplace_back(std::move(name), value);
+    }
+
+    /**
+     * @struct Case
+     * @brief A registered benchmark case.
+     * @details The body is called with the iteration count and returns the number of operations it performed,
+     * which is usually the iteration count.
+     */
+    struct Case {
+        std::string_view name{};
+        std::size_t iterations{};
+        std::function<std::size_t(std::size_t)> body{};
+    };
+
+    /**
+     * @brief The list of registered cases.
+     */
+    std::vector<Case> &registry();
+
+    /**
+     * @struct Registrar
+     * @brief Register a benchmark case at static initialization time.
+     */
+    struct Registrar {
+        Registrar(std::string_view name, std::size_t iterations, std::function<std::size_t(std::size_t)> body) {
+            registry().push_back(Case{name, iterations, std::move(body)});
+        }
+    };
+
+    /**
+     * @brief Prevent the optimizer from discarding a value computed by a benchmark.
+     */
+    template<class Value>
+    inline void doNotOptimize(const Value &value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    /**
+     * @brief Run a case and time it.
+     */
+    inline Result run(const Case &benchCase) {
+        counters().clear();
+        auto allocations = ysh::allocation::counts();
+        auto begin = std::chrono::steady_clock::now();
+        auto operations = benchCase.body(benchCase.iterations);
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin);
+        allocations = ysh::allocation::counts() - allocations;
+        auto perOp = [operations](double value) {
+            return operations ? value / static_cast<double>(operations) : 0.0;
+        };
+        return Result{std::string{benchCase.name}, operations, perOp(elapsed.count()), perOp(elapsed.count()), 1,
+                      perOp(static_cast<double>(allocations.allocations)), std::move(counters())};
+    }
+
+} // bench
+
+#endif //VE3YSH_UTIL_BENCHMARK_H
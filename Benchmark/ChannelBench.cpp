@@ -0,0 +1,187 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * ChannelBench.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file ChannelBench.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Measure handing values between threads with channels and with a MutexGuarded std::deque.
+ * @details Throughput cases stream values from producers to consumers, ns/op is per value. Latency cases
+ * bounce one value between two threads, ns/op is per round trip and the p50 and p99 round trips are
+ * reported. The MutexGuarded cases poll, yielding when the deque is empty, which is the pattern the
+ * channels replace.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+#include <Channel.h>
+#include <Metrics.h>
+#include <MutexGuarded.h>
+#include "Benchmark.h"
+
+namespace {
+    constexpr std::size_t Capacity = 1024;
+    constexpr std::size_t Batch = 64;
+
+    /**
+     * @brief The polled queue the channels replace, with the same interface as the channels.
+     */
+    class GuardedDeque {
+    private:
+        ysh::MutexGuarded<std::deque<std::size_t>> mDeque{};
+
+    public:
+        explicit GuardedDeque(std::size_t) {}
+
+        bool push(std::size_t value) {
+            mDeque.with([value](std::deque<std::size_t> &deque) { deque.push_back(value); });
+            return true;
+        }
+
+        std::optional<std::size_t> pop() {
+            for (;;) {
+                auto value = mDeque.with([](std::deque<std::size_t> &deque) -> std::optional<std::size_t> {
+                    if (deque.empty())
+                        return std::nullopt;
+                    auto front = deque.front();
+                    deque.pop_front();
+                    return front;
+                });
+                if (value)
+                    return value;
+                std::this_thread::yield();
+            }
+        }
+    };
+
+    /**
+     * @brief Stream n values from producers to consumers.
+     */
+    template<class Queue>
+    std::size_t stream(std::size_t n, std::size_t producers, std::size_t consumers) {
+        Queue queue{Capacity};
+        std::atomic<std::size_t> sum{0};
+        std::vector<std::thread> threads{};
+        for (std::size_t consumer = 0; consumer < consumers; ++consumer)
+            threads.emplace_back([&queue, &sum, count = n / consumers] {
+                std::size_t local = 0;
+                for (std::size_t i = 0; i < count; ++i)
+                    local += *queue.pop();
+                sum.fetch_add(local, std::memory_order_relaxed);
+            });
+        for (std::size_t producer = 0; producer < producers; ++producer)
+            threads.emplace_back([&queue, count = n / producers] {
+                for (std::size_t i = 0; i < count; ++i)
+                    queue.push(i);
+            });
+        for (auto &thread : threads)
+            thread.join();
+        bench::doNotOptimize(sum.load());
+        return n / producers * producers;
+    }
+
+    /**
+     * @brief Stream n values from one producer to one consumer in batches.
+     */
+    template<class Channel>
+    std::size_t streamBatches(std::size_t n) {
+        Channel channel{Capacity};
+        std::thread consumer{[&channel, n] {
+            std::vector<std::size_t> values(Batch);
+            std::size_t sum = 0;
+            for (std::size_t received = 0; received < n;) {
+                auto count = channel.popBatch(values);
+                for (std::size_t i = 0; i < count; ++i)
+                    sum += values[i];
+                received += count;
+            }
+            bench::doNotOptimize(sum);
+        }};
+        std::vector<std::size_t> values(Batch);
+        for (std::size_t sent = 0; sent < n; sent += Batch) {
+            for (std::size_t i = 0; i < Batch; ++i)
+                values[i] = sent + i;
+            channel.pushBatch(std::span{values}.first(std::min(Batch, n - sent)));
+        }
+        consumer.join();
+        return n;
+    }
+
+    /**
+     * @brief Bounce a value between two threads n times.
+     */
+    template<class Queue>
+    std::size_t pingPong(std::size_t n) {
+        Queue ping{Capacity};
+        Queue pong{Capacity};
+        std::thread echo{[&ping, &pong, n] {
+            for (std::size_t i = 0; i < n; ++i)
+                pong.push(*ping.pop());
+        }};
+        ysh::Histogram roundTrips{};
+        for (std::size_t i = 0; i < n; ++i) {
+            auto begin = std::chrono::steady_clock::now();
+            ping.push(i);
+            bench::doNotOptimize(*pong.pop());
+            roundTrips.record(static_cast<std::uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin)
+                            .count()));
+        }
+        echo.join();
+        auto snapshot = roundTrips.snapshot();
+        bench::report("p50_ns", static_cast<double>(snapshot.quantile(0.5)));
+        bench::report("p99_ns", static_cast<double>(snapshot.quantile(0.99)));
+        return n;
+    }
+
+    bench::Registrar dequeOne{"channel.MutexGuarded<deque> 1x1", 2000000, [](std::size_t n) {
+        return stream<GuardedDeque>(n, 1, 1);
+    }};
+
+    bench::Registrar spscOne{"channel.SpscChannel 1x1", 2000000, [](std::size_t n) {
+        return stream<ysh::SpscChannel<std::size_t>>(n, 1, 1);
+    }};
+
+    bench::Registrar spscBatch{"channel.SpscChannel 1x1 batch 64", 2000000, [](std::size_t n) {
+        return streamBatches<ysh::SpscChannel<std::size_t>>(n);
+    }};
+
+    bench::Registrar mpmcOne{"channel.MpmcChannel 1x1", 2000000, [](std::size_t n) {
+        return stream<ysh::MpmcChannel<std::size_t>>(n, 1, 1);
+    }};
+
+    bench::Registrar mpmcBatch{"channel.MpmcChannel 1x1 batch 64", 2000000, [](std::size_t n) {
+        return streamBatches<ysh::MpmcChannel<std::size_t>>(n);
+    }};
+
+    bench::Registrar dequeFour{"channel.MutexGuarded<deque> 2x2", 2000000, [](std::size_t n) {
+        return stream<GuardedDeque>(n, 2, 2);
+    }};
+
+    bench::Registrar mpmcFour{"channel.MpmcChannel 2x2", 2000000, [](std::size_t n) {
+        return stream<ysh::MpmcChannel<std::size_t>>(n, 2, 2);
+    }};
+
+    bench::Registrar dequeLatency{"channel.MutexGuarded<deque> round trip", 100000, [](std::size_t n) {
+        return pingPong<GuardedDeque>(n);
+    }};
+
+    bench::Registrar spscLatency{"channel.SpscChannel round trip", 100000, [](std::size_t n) {
+        return pingPong<ysh::SpscChannel<std::size_t>>(n);
+    }};
+
+    bench::Registrar mpmcLatency{"channel.MpmcChannel round trip", 100000, [](std::size_t n) {
+        return pingPong<ysh::MpmcChannel<std::size_t>>(n);
+    }};
+}
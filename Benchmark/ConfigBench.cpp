@@ -0,0 +1,129 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * ConfigBench.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file ConfigBench.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Measure ConfigFile::process on a synthetic 10k line file with 20 keys.
+ * @details The large file cases parse a 2M line file, about 40 MB, once with the process() getline loop and
+ * then with processParallel() on pools of 1, 2, 4 ... threads up to the CPU affinity count, delivering
+ * Ordered and Unordered. ns/op is per line. The large file is written by the first case that runs, use -r and
+ * compare the min.
+ */
+
+#include <atomic>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <StringComposite.h>
+#include <ThreadPool.h>
+#include "Benchmark.h"
+#include "../Config/ConfigFile.h"
+
+namespace {
+    constexpr std::size_t KeyCount = 20;
+    constexpr std::size_t LineCount = 10000;
+    constexpr std::size_t LargeLineCount = 2000000;
+
+    std::filesystem::path writeConfig(std::string_view name, std::size_t lineCount) {
+        auto file = std::filesystem::temp_directory_path() / name;
+        std::ofstream out{file, std::ios::trunc};
+        for (std::size_t line = 0; line < lineCount; ++line) {
+            if (line % 10 == 0)
+                out << "# Comment line " << line << '\n';
+            else
+                out << "key_" << line % KeyCount << "  value " << line << '\n';
+        }
+        return file;
+    }
+
+    const std::filesystem::path &configPath() {
+        static const std::filesystem::path path = writeConfig("ve3ysh_bench.conf", LineCount);
+        return path;
+    }
+
+    const std::filesystem::path &largeConfigPath() {
+        static const std::filesystem::path path = writeConfig("ve3ysh_bench_large.conf", LargeLineCount);
+        return path;
+    }
+
+    const std::vector<ConfigFile::Spec> &configSpecs() {
+        static const std::vector<std::string> keys = [] {
+            std::vector<std::string> result{};
+            for (std::size_t key = 0; key < KeyCount; ++key)
+                result.push_back(ysh::StringComposite("key_", key));
+            return result;
+        }();
+        static const std::vector<ConfigFile::Spec> specs = [] {
+            std::vector<ConfigFile::Spec> result{};
+            for (std::size_t key = 0; key < KeyCount; ++key)
+                result.emplace_back(keys[key], key);
+            return result;
+        }();
+        return specs;
+    }
+
+    bench::Registrar process{"config.ConfigFile.process 10k lines", 200, [](std::size_t n) {
+        auto &specs = configSpecs();
+        std::size_t values = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            ConfigFile configFile{configPath()};
+            configFile.open();
+            configFile.process(specs, [&values](std::size_t, const std::string_view &) { ++values; });
+            configFile.close();
+        }
+        bench::doNotOptimize(values);
+        bench::report("lines/op", static_cast<double>(LineCount));
+        return n;
+    }};
+
+    bench::Registrar large{"config.ConfigFile.process 2M lines getline", 5, [](std::size_t n) {
+        std::size_t values = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            ConfigFile configFile{largeConfigPath()};
+            configFile.open();
+            configFile.process(configSpecs(), [&values](std::size_t, const std::string_view &) { ++values; });
+            configFile.close();
+        }
+        bench::doNotOptimize(values);
+        return n * LargeLineCount;
+    }};
+
+    const bool scaling = [] {
+        static std::deque<std::string> names{};
+        auto cpus = ysh::ThreadPool::affinityCount();
+        for (std::size_t threads = 1;; threads = std::min(threads * 2, cpus)) {
+            for (auto delivery : {ConfigFile::Delivery::Ordered, ConfigFile::Delivery::Unordered}) {
+                names.push_back(ysh::StringComposite("config.ConfigFile.processParallel 2M lines ",
+                                                     delivery == ConfigFile::Delivery::Ordered ? "ordered " : "unordered ",
+                                                     threads, " threads"));
+                bench::Registrar{names.back(), 5, [threads, delivery](std::size_t n) {
+                    ysh::ThreadPool pool{threads};
+                    std::atomic<std::size_t> values{0};
+                    for (std::size_t i = 0; i < n; ++i) {
+                        ConfigFile configFile{largeConfigPath()};
+                        configFile.open();
+                        configFile.processParallel(configSpecs(), [&values](std::size_t, const std::string_view &) {
+                            values.fetch_add(1, std::memory_order_relaxed);
+                        }, delivery, &pool);
+                        configFile.close();
+                    }
+                    bench::doNotOptimize(values.load());
+                    return n * LargeLineCount;
+                }};
+            }
+            if (threads == cpus)
+                break;
+        }
+        return true;
+    }();
+}
@@ -0,0 +1,78 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * InfluxBench.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file InfluxBench.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Measure the InfluxDB line protocol encode path.
+ * @details A steady state push loop fills the store and clears it once per cycle. After the first cycle it
+ * should report zero allocations per operation.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sstream>
+#include <FileDescriptor.h>
+#include <StringArena.h>
+#include "Benchmark.h"
+#include "../Influx/InfluxLineBuffer.h"
+
+namespace {
+    constexpr std::size_t LinesPerPush = 100;
+    constexpr unsigned long long TimeStamp{1700000000000000000ULL};
+    const std::string prefix{"thermostat,id=living_room "};
+
+    bench::Registrar lineBuffer{"influx.InfluxLineBuffer.add", 1000000, [](std::size_t n) {
+        InfluxLineBuffer buffer{};
+        for (std::size_t i = 0; i < LinesPerPush; ++i)     // Warm up to the size of one push.
+            buffer.add(prefix, "temperature", 21.5, TimeStamp);
+        for (std::size_t i = 0; i < n; ++i) {
+            if (i % LinesPerPush == 0)
+                buffer.clear();
+            buffer.add(prefix, "temperature", 21.5 + static_cast<double>(i % 10), TimeStamp + i);
+        }
+        bench::doNotOptimize(buffer.size());
+        return n;
+    }};
+
+    bench::Registrar lineBufferSink{"influx.InfluxLineBuffer.add+sink", 1000000, [](std::size_t n) {
+        // The push path without the network, each full store is written to /dev/null.
+        ysh::FileDescriptor sink{open("/dev/null", O_WRONLY | O_CLOEXEC)};
+        InfluxLineBuffer buffer{};
+        for (std::size_t i = 0; i < n; ++i) {
+            buffer.add(prefix, "temperature", 21.5 + static_cast<double>(i % 10), TimeStamp + i);
+            if (i % LinesPerPush == LinesPerPush - 1) {
+                bench::doNotOptimize(write(sink.get(), buffer.view().data(), buffer.size()));
+                buffer.clear();
+            }
+        }
+        return n;
+    }};
+
+    bench::Registrar stringStream{"influx.std::stringstream", 1000000, [](std::size_t n) {
+        std::stringstream buffer{};
+        for (std::size_t i = 0; i < n; ++i) {
+            if (i % LinesPerPush == 0)
+                buffer.str("");
+            buffer << prefix << "temperature" << '=' << std::to_string(21.5 + static_cast<double>(i % 10))
+                   << ' ' << TimeStamp + i << '\n';
+        }
+        bench::doNotOptimize(buffer.tellp());
+        return n;
+    }};
+
+    bench::Registrar arena{"arena.StringArena.composite", 1000000, [](std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) {
+            ysh::ArenaScope scope{};
+            bench::doNotOptimize(scope.arena().composite("Command line option '", prefix, "' not found at ", i));
+        }
+        return n;
+    }};
+}
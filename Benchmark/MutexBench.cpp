@@ -0,0 +1,47 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * MutexBench.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file MutexBench.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Measure MutexGuarded under contention from 1, 2 and 4 threads.
+ */
+
+#include <thread>
+#include <vector>
+#include <MutexGuarded.h>
+#include "Benchmark.h"
+
+namespace {
+    std::size_t contend(std::size_t n, std::size_t threads) {
+        ysh::MutexGuarded<std::size_t> counter{};
+        std::vector<std::thread> workers{};
+        for (std::size_t thread = 0; thread < threads; ++thread)
+            workers.emplace_back([&counter, count = n / threads] {
+                for (std::size_t i = 0; i < count; ++i)
+                    counter.with([](std::size_t &value) { ++value; });
+            });
+        for (auto &worker : workers)
+            worker.join();
+        return counter.with([](const std::size_t &value) { return value; });
+    }
+
+    bench::Registrar oneThread{"mutex.MutexGuarded.with 1 thread", 4000000, [](std::size_t n) {
+        return contend(n, 1);
+    }};
+
+    bench::Registrar twoThreads{"mutex.MutexGuarded.with 2 threads", 4000000, [](std::size_t n) {
+        return contend(n, 2);
+    }};
+
+    bench::Registrar fourThreads{"mutex.MutexGuarded.with 4 threads", 4000000, [](std::size_t n) {
+        return contend(n, 4);
+    }};
+}
@@ -0,0 +1,67 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * ObjectPoolBench.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file ObjectPoolBench.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Measure a short lived 4 KiB buffer from the heap and from ObjectPool.
+ * @details Each operation gets a buffer, fills it and lets it go. The pooled cases report the hit rate and
+ * high water mark of the pool, the cross thread case releases buffers on a different thread than acquired
+ * them, so they pass through the shared overflow stack.
+ */
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <ObjectPool.h>
+#include "Benchmark.h"
+
+namespace {
+    constexpr std::size_t BufferSize = 4096;
+
+    void reportPool() {
+        auto stats = ysh::ObjectPool<std::string>::instance().stats();
+        bench::report("hit_rate", stats.hitRate());
+        bench::report("high_water", static_cast<double>(stats.highWater));
+    }
+
+    bench::Registrar heap{"pool.std::string 4KiB", 1000000, [](std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) {
+            std::string buffer{};
+            buffer.append(BufferSize, static_cast<char>('a' + i % 26));
+            bench::doNotOptimize(buffer.data());
+        }
+        return n;
+    }};
+
+    bench::Registrar pooled{"pool.PooledBuffer 4KiB", 1000000, [](std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) {
+            auto buffer = ysh::acquireBuffer();
+            buffer->append(BufferSize, static_cast<char>('a' + i % 26));
+            bench::doNotOptimize(buffer->data());
+        }
+        reportPool();
+        return n;
+    }};
+
+    bench::Registrar crossThread{"pool.PooledBuffer 4KiB cross thread", 1000000, [](std::size_t n) {
+        constexpr std::size_t Batch = 64;
+        std::vector<ysh::PooledBuffer> buffers{};
+        for (std::size_t i = 0; i < n; i += Batch) {
+            for (std::size_t j = 0; j < Batch; ++j) {
+                buffers.push_back(ysh::acquireBuffer());
+                buffers.back()->append(BufferSize, static_cast<char>('a' + j % 26));
+            }
+            std::thread{[&buffers] { buffers.clear(); }}.join();
+        }
+        reportPool();
+        return n / Batch * Batch;
+    }};
+}
@@ -0,0 +1,86 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * SeriesBench.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file SeriesBench.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Compare encoding 1M points of 10k series by prefix and name with interned series keys.
+ * @details Each case reports the memory held for the series keys. The prefix and name case holds the
+ * strings a caller keeps to call addMeasurement(), the interned case holds the registry.
+ */
+
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+#include "../Influx/InfluxSeries.h"
+
+namespace {
+    constexpr std::size_t Series = 10000;
+    constexpr std::size_t Points = 1000000;
+    constexpr std::size_t LinesPerPush = 5000;
+    constexpr unsigned long long TimeStamp{1700000000000000000ULL};
+
+    std::string prefixOf(std::size_t series) {
+        return ysh::StringComposite("environment,site=north_field,sensor=", series / 4, ' ');
+    }
+
+    const char *nameOf(std::size_t series) {
+        static constexpr const char *Names[] = {"temperature", "humidity", "pressure", "battery"};
+        return Names[series % 4];
+    }
+
+    bench::Registrar prefixName{"influx.series prefix,name 10k series", Points, [](std::size_t n) {
+        std::vector<std::pair<std::string, std::string>> series{};
+        std::size_t bytes = 0;
+        for (std::size_t i = 0; i < Series; ++i) {
+            series.emplace_back(prefixOf(i), nameOf(i));
+            bytes += sizeof(series.back()) + series.back().first.capacity() + 1 + series.back().second.capacity() + 1;
+        }
+        InfluxLineBuffer buffer{};
+        auto allocations = ysh::allocation::counts();
+        auto begin = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < n; ++i) {
+            if (i % LinesPerPush == 0)
+                buffer.clear();
+            const auto &[prefix, name] = series[i % Series];
+            buffer.add(prefix, name, 20.0 + static_cast<double>(i % 100) * 0.25, TimeStamp + i);
+        }
+        bench::doNotOptimize(buffer.size());
+        bench::report("key_bytes", static_cast<double>(bytes));
+        bench::report("encode_ns/pt", std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - begin).count() / static_cast<double>(n));
+        bench::report("encode_allocs", static_cast<double>((ysh::allocation::counts() - allocations).allocations));
+        return n;
+    }};
+
+    bench::Registrar interned{"influx.series interned 10k series", Points, [](std::size_t n) {
+        InfluxSeriesRegistry registry{};
+        std::vector<InfluxSeriesId> ids{};
+        for (std::size_t i = 0; i < Series; ++i) {
+            auto sensor = ysh::StringComposite(i / 4);
+            std::array<InfluxSeriesRegistry::Tag, 2> tags{{{"site", "north_field"}, {"sensor", sensor}}};
+            ids.push_back(registry.intern("environment", tags, nameOf(i)));
+        }
+        InfluxLineBuffer buffer{};
+        auto allocations = ysh::allocation::counts();
+        auto begin = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < n; ++i) {
+            if (i % LinesPerPush == 0)
+                buffer.clear();
+            registry.write(buffer, ids[i % Series], 20.0 + static_cast<double>(i % 100) * 0.25, TimeStamp + i);
+        }
+        bench::doNotOptimize(buffer.size());
+        bench::report("key_bytes", static_cast<double>(registry.memoryUsage() + ids.capacity() * sizeof(InfluxSeriesId)));
+        bench::report("encode_ns/pt", std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - begin).count() / static_cast<double>(n));
+        bench::report("encode_allocs", static_cast<double>((ysh::allocation::counts() - allocations).allocations));
+        return n;
+    }};
+}
@@ -0,0 +1,112 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * StringBench.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file StringBench.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Compare the string compositors on a typical error message.
+ * @details StringStreamComposite() and xdg::StringCompositor() now forward to StringComposite(). The
+ * compositors they were before, and the StringAppend based StringComposite(), are kept here as baselines.
+ */
+
+#include <sstream>
+#include <StringComposite.h>
+#include "Benchmark.h"
+
+namespace {
+    namespace baseline {
+        /**
+         * @brief The std::stringstream compositor StringStreamComposite() and xdg::StringCompositor() were.
+         */
+        template<typename Arg, typename... Args>
+        std::string streamComposite(Arg &&arg, Args &&... args) {
+            std::stringstream out{};
+            out << std::forward<Arg>(arg);
+            ((out << std::forward<Args>(args)), ...);
+            return out.str();
+        }
+
+        /**
+         * @brief The StringAppend compositor StringComposite() was.
+         */
+        template<typename Arg, typename... Args>
+        std::string appendComposite(Arg &&arg, Args &&... args) {
+            ysh::StringAppend out{};
+            out.appendArg(std::forward<Arg>(arg));
+            (out.appendArg(std::forward<Args>(args)), ...);
+            return out;
+        }
+    }
+
+    const std::string option{"--output"};
+    constexpr long lineNumber{1234567};
+    constexpr double value{273.15};
+
+    bench::Registrar composite{"string.StringComposite", 1000000, [](std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i)
+            bench::doNotOptimize(ysh::StringComposite("Option '", option, "' at line ", lineNumber,
+                                                      " has bad value ", value, '.'));
+        return n;
+    }};
+
+    bench::Registrar compositePath{"string.StringComposite.path", 1000000, [](std::size_t n) {
+        static const std::filesystem::path procExec{"/proc/self/exe"};
+        for (std::size_t i = 0; i < n; ++i)
+            bench::doNotOptimize(ysh::StringComposite('"', procExec, '"', " is not a symbolic link to application.\n"));
+        return n;
+    }};
+
+    bench::Registrar compositeTo{"string.StringCompositeTo", 1000000, [](std::size_t n) {
+        std::array<char, 128> buffer{};
+        for (std::size_t i = 0; i < n; ++i)
+            bench::doNotOptimize(ysh::StringCompositeTo(buffer, "Option '", option, "' at line ", lineNumber,
+                                                        " has bad value ", value, '.'));
+        return n;
+    }};
+
+    bench::Registrar compositeInline{"string.StringCompositeInline", 1000000, [](std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i)
+            bench::doNotOptimize(ysh::StringCompositeInline<128>("Option '", option, "' at line ", lineNumber,
+                                                                 " has bad value ", value, '.'));
+        return n;
+    }};
+
+    bench::Registrar ostringstream{"string.std::ostringstream", 1000000, [](std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) {
+            std::ostringstream out{};
+            out << "Option '" << option << "' at line " << lineNumber << " has bad value " << value << '.';
+            bench::doNotOptimize(out.str());
+        }
+        return n;
+    }};
+
+    bench::Registrar streamComposite{"string.baseline.StringStreamComposite", 1000000, [](std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i)
+            bench::doNotOptimize(baseline::streamComposite("Option '", option, "' at line ", lineNumber,
+                                                           " has bad value ", value, '.'));
+        return n;
+    }};
+
+    bench::Registrar streamCompositePath{"string.baseline.StringStreamComposite.path", 1000000, [](std::size_t n) {
+        static const std::filesystem::path procExec{"/proc/self/exe"};
+        for (std::size_t i = 0; i < n; ++i)
+            bench::doNotOptimize(baseline::streamComposite('"', procExec, '"',
+                                                           " is not a symbolic link to application.\n"));
+        return n;
+    }};
+
+    bench::Registrar appendComposite{"string.baseline.StringAppend", 1000000, [](std::size_t n) {
+        char period = '.';
+        for (std::size_t i = 0; i < n; ++i)
+            bench::doNotOptimize(baseline::appendComposite("Option '", option, "' at line ", lineNumber,
+                                                           " has bad value ", value, period));
+        return n;
+    }};
+}
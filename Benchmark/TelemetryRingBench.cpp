@@ -0,0 +1,74 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * TelemetryRingBench.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file TelemetryRingBench.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Measure the cost of writing a point to the shared memory telemetry ring.
+ * @details The write case drains the ring every half ring, so ns/op is a write plus its share of the
+ * reader. The full case never drains, every write takes the drop path. The in process InfluxLineBuffer
+ * case is the floor, the cost of formatting the same line. The rings are made in the temporary directory
+ * and unlinked once mapped.
+ */
+
+#include <unistd.h>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include "../Influx/InfluxTelemetryRing.h"
+#include "Benchmark.h"
+
+namespace {
+    constexpr std::string_view Prefix{"telemetry,tool=bench "};
+
+    std::unique_ptr<InfluxTelemetryRing> makeRing() {
+        auto path = std::filesystem::temp_directory_path()
+                    / ysh::StringComposite("bench-telemetry-", getpid(), ".ring");
+        auto ring = std::make_unique<InfluxTelemetryRing>(path);
+        std::filesystem::remove(path);
+        return ring;
+    }
+
+    bench::Registrar lineBuffer{"telemetry.InfluxLineBuffer add", 2000000, [](std::size_t n) {
+        InfluxLineBuffer lines{};
+        for (std::size_t i = 0; i < n; ++i) {
+            if (lines.size() > 1u << 20)
+                lines.clear();
+            lines.add(Prefix, "value", i, 1700000000000000000ull + i);
+        }
+        bench::doNotOptimize(lines.size());
+        return n;
+    }};
+
+    bench::Registrar write{"telemetry.ring add", 2000000, [](std::size_t n) {
+        auto ring = makeRing();
+        ring->attachReader();
+        auto drainEvery = ring->capacity() / 2;
+        InfluxLineBuffer drained{};
+        for (std::size_t i = 0; i < n; ++i) {
+            ring->add(Prefix, "value", i, 1700000000000000000ull + i);
+            if (i % drainEvery == drainEvery - 1) {
+                drained.clear();
+                ring->read(drained, drainEvery);
+                ring->commit();
+            }
+        }
+        bench::report("dropped", static_cast<double>(ring->stats().dropped));
+        return n;
+    }};
+
+    bench::Registrar full{"telemetry.ring add full", 2000000, [](std::size_t n) {
+        auto ring = makeRing();
+        for (std::size_t i = 0; i < n; ++i)
+            ring->add(Prefix, "value", i, 1700000000000000000ull + i);
+        bench::report("dropped", static_cast<double>(ring->stats().dropped));
+        return n;
+    }};
+}
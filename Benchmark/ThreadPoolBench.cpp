@@ -0,0 +1,85 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * ThreadPoolBench.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file ThreadPoolBench.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Measure ThreadPool scaling and task overhead.
+ * @details parallel_for runs a compute bound loop on pools of 1, 2, 4 ... threads up to the CPU affinity
+ * count, ns/op is per index. The fan out cases run 64 small tasks and wait for them, once with submit() and
+ * once with std::async, which is the hand rolled pattern the pool replaces.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <string>
+#include <vector>
+#include <ThreadPool.h>
+#include "Benchmark.h"
+
+namespace {
+    constexpr std::size_t FanOut = 64;
+
+    /**
+     * @brief Roughly 100 ns of work that depends on its argument.
+     */
+    std::uint64_t work(std::uint64_t value) {
+        for (int round = 0; round < 64; ++round)
+            value = value * 6364136223846793005ull + 1442695040888963407ull;
+        return value;
+    }
+
+    const bool scaling = [] {
+        static std::deque<std::string> names{};
+        auto cpus = ysh::ThreadPool::affinityCount();
+        for (std::size_t threads = 1;; threads = std::min(threads * 2, cpus)) {
+            names.push_back("threadpool.parallel_for " + std::to_string(threads) + " threads");
+            bench::Registrar{names.back(), 4000000, [threads](std::size_t n) {
+                ysh::ThreadPool pool{threads};
+                std::atomic<std::uint64_t> sum{0};
+                pool.parallel_for(0, n, [&sum](std::size_t idx) {
+                    sum.fetch_add(work(idx) & 1, std::memory_order_relaxed);
+                }, 4096);
+                bench::doNotOptimize(sum.load());
+                return n;
+            }};
+            if (threads == cpus)
+                break;
+        }
+        return true;
+    }();
+
+    bench::Registrar submit{"threadpool.submit fan out 64", 20000, [](std::size_t n) {
+        auto &pool = ysh::ThreadPool::instance();
+        std::vector<std::future<std::uint64_t>> futures{};
+        for (std::size_t i = 0; i < n; ++i) {
+            futures.clear();
+            for (std::size_t task = 0; task < FanOut; ++task)
+                futures.push_back(pool.submit([task] { return work(task); }));
+            for (auto &future : futures)
+                bench::doNotOptimize(future.get());
+        }
+        return n;
+    }};
+
+    bench::Registrar async{"threadpool.std::async fan out 64", 2000, [](std::size_t n) {
+        std::vector<std::future<std::uint64_t>> futures{};
+        for (std::size_t i = 0; i < n; ++i) {
+            futures.clear();
+            for (std::size_t task = 0; task < FanOut; ++task)
+                futures.push_back(std::async(std::launch::async, [task] { return work(task); }));
+            for (auto &future : futures)
+                bench::doNotOptimize(future.get());
+        }
+        return n;
+    }};
+}
@@ -0,0 +1,41 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * XDGBench.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file XDGBench.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Measure XDGFilePaths construction, with and without reading every path set.
+ */
+
+#include "Benchmark.h"
+#include "../XDG/XDGFilePaths.h"
+
+namespace {
+    bench::Registrar construct{"xdg.XDGFilePaths construct", 100000, [](std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) {
+            xdg::XDGFilePaths filePaths{};
+            bench::doNotOptimize(&filePaths);
+        }
+        return n;
+    }};
+
+    bench::Registrar constructAll{"xdg.XDGFilePaths construct+paths", 100000, [](std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) {
+            xdg::XDGFilePaths filePaths{};
+            std::size_t count = 0;
+            for (auto name : {xdg::XDGFilePaths::XDG_DATA_HOME, xdg::XDGFilePaths::XDG_CONFIG_HOME,
+                              xdg::XDGFilePaths::XDG_RUNTIME_DIR, xdg::XDGFilePaths::XDG_DATA_DIRS,
+                              xdg::XDGFilePaths::XDG_CONFIG_DIRS, xdg::XDGFilePaths::XDG_CACHE_HOME})
+                count += filePaths.paths(name).size();
+            bench::doNotOptimize(count);
+        }
+        return n;
+    }};
+}
@@ -13,12 +13,378 @@
  * @date 09/02/23
  */
 
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio_ext.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
 #include "BMain.h"
+#include "FileDescriptor.h"
+
+namespace better_main {
+
+    namespace {
+
+        constexpr std::uint32_t RequestMagic = 0x424d5231;      ///< "BMR1"
+        constexpr std::uint32_t MaxRequestLength = 1u << 24;
+        constexpr long DefaultIdleSeconds = 600;
+
+        /**
+         * @struct RequestHeader
+         * @brief Sent with the standard file descriptors, followed by length bytes of null terminated strings:
+         * the working directory, argc arguments and envc environment entries.
+         */
+        struct RequestHeader {
+            std::uint32_t magic{RequestMagic};
+            std::uint32_t argc{0};
+            std::uint32_t envc{0};
+            std::uint32_t length{0};
+        };
+
+        constexpr int BusyTimeoutMs = 20;
+
+        std::atomic<pid_t> residentServer{0};
+        std::atomic<int> residentSignal{0};
+
+        bool writeAll(int fd, const void *data, std::size_t size) {
+            auto bytes = static_cast<const char *>(data);
+            while (size) {
+                auto count = ::write(fd, bytes, size);
+                if (count < 0 && errno == EINTR)
+                    continue;
+                if (count <= 0)
+                    return false;
+                bytes += count;
+                size -= static_cast<std::size_t>(count);
+            }
+            return true;
+        }
+
+        bool readAll(int fd, void *data, std::size_t size) {
+            auto bytes = static_cast<char *>(data);
+            while (size) {
+                auto count = ::read(fd, bytes, size);
+                if (count < 0 && errno == EINTR)
+                    continue;
+                if (count <= 0)
+                    return false;
+                bytes += count;
+                size -= static_cast<std::size_t>(count);
+            }
+            return true;
+        }
+
+        /**
+         * @brief The socket of this executable's server, named for the program and the identity of its file.
+         * @return The socket address, or std::nullopt if resident mode is not available.
+         */
+        std::optional<sockaddr_un> residentAddress(std::string_view program) {
+            auto runtimeDir = getenv("XDG_RUNTIME_DIR");
+            struct stat exe{};
+            if (runtimeDir == nullptr || *runtimeDir != '/' || stat("/proc/self/exe", &exe) != 0)
+                return std::nullopt;
+
+            // FNV-1a over the file identity, a rebuilt or replaced executable gets a new server.
+            std::uint64_t hash = 14695981039346656037ull;
+            for (auto value : {static_cast<std::uint64_t>(exe.st_dev), static_cast<std::uint64_t>(exe.st_ino),
+                               static_cast<std::uint64_t>(exe.st_mtim.tv_sec),
+                               static_cast<std::uint64_t>(exe.st_mtim.tv_nsec)})
+                for (int byte = 0; byte < 8; ++byte)
+                    hash = (hash ^ ((value >> (byte * 8)) & 0xff)) * 1099511628211ull;
+            std::array<char, 16> hex{};
+            auto hexEnd = std::to_chars(hex.begin(), hex.end(), hash, 16).ptr;
+
+            if (auto slash = program.rfind('/'); slash != std::string_view::npos)
+                program.remove_prefix(slash + 1);
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            auto path = ysh::StringCompositeTo(std::span{address.sun_path, sizeof(address.sun_path) - 1},
+                                               std::string_view{runtimeDir}, "/better_main-", program.substr(0, 32),
+                                               '-', std::string_view{hex.begin(), hexEnd}, ".sock");
+            if (!path.complete)
+                return std::nullopt;
+            return address;
+        }
+
+        /**
+         * @brief Forward a signal to the server running this invocation.
+         */
+        void forwardSignal(int signal) {
+            if (auto server = residentServer.load(std::memory_order_relaxed); server > 0) {
+                residentSignal.store(signal, std::memory_order_relaxed);
+                kill(server, signal);
+            }
+        }
+
+        /**
+         * @brief Have the server run this invocation.
+         * @return The exit status, or std::nullopt if the server did not take the request within BusyTimeout,
+         * in which case nothing has run.
+         */
+        std::optional<int> request(int fd, int argc, char const *const *argv) {
+            std::string payload{};
+            if (auto cwd = getcwd(nullptr, 0)) {
+                payload.append(cwd).push_back('\0');
+                free(cwd);
+            } else {
+                return std::nullopt;
+            }
+            for (int idx = 0; idx < argc; ++idx)
+                payload.append(argv[idx]).push_back('\0');
+            RequestHeader header{};
+            header.argc = static_cast<std::uint32_t>(argc);
+            for (auto env = environ; *env; ++env, ++header.envc)
+                payload.append(*env).push_back('\0');
+            if (payload.size() > MaxRequestLength)
+                return std::nullopt;
+            header.length = static_cast<std::uint32_t>(payload.size());
+
+            int fds[3] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))]{};
+            iovec iov{&header, sizeof(header)};
+            msghdr message{};
+            message.msg_iov = &iov;
+            message.msg_iovlen = 1;
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+            auto cmsg = CMSG_FIRSTHDR(&message);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+            std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+            if (sendmsg(fd, &message, MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(header))
+                || !writeAll(fd, payload.data(), payload.size()))
+                return std::nullopt;
+
+            // The server acknowledges with its pid when it is free. Only the go byte lets it run the request,
+            // so an invocation that gives up waiting can never run twice.
+            pollfd acknowledged{fd, POLLIN, 0};
+            std::int32_t server{0};
+            if (poll(&acknowledged, 1, BusyTimeoutMs) != 1 || !readAll(fd, &server, sizeof(server)) || server <= 0)
+                return std::nullopt;
+            residentServer.store(server, std::memory_order_relaxed);
+            struct sigaction forward{};
+            forward.sa_handler = forwardSignal;
+            forward.sa_flags = SA_RESTART;
+            sigemptyset(&forward.sa_mask);
+            for (auto signal : {SIGINT, SIGTERM, SIGHUP, SIGQUIT})
+                sigaction(signal, &forward, nullptr);
+            if (char go = 'G'; send(fd, &go, 1, MSG_NOSIGNAL) != 1)
+                return std::nullopt;
+
+            std::int32_t status{1};
+            if (!readAll(fd, &status, sizeof(status))) {
+                // The server went away, killed by a forwarded signal or by the request itself.
+                auto signal = residentSignal.load(std::memory_order_relaxed);
+                return signal ? 128 + signal : 1;
+            }
+            return status;
+        }
+
+        /**
+         * @class Context
+         * @brief The standard file descriptors, working directory and environment of the request being served.
+         */
+        class Context {
+        private:
+            std::string mPayload{};             ///< Holds the environment strings given to putenv().
+            std::vector<std::string_view> mArgs{};
+
+        public:
+            /**
+             * @brief Receive a request and adopt its context.
+             * @return The arguments, or an empty span if the request was not valid.
+             */
+            std::span<const std::string_view> adopt(int connection) {
+                RequestHeader header{};
+                int fds[3] = {-1, -1, -1};
+                alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))]{};
+                iovec iov{&header, sizeof(header)};
+                msghdr message{};
+                message.msg_iov = &iov;
+                message.msg_iovlen = 1;
+                message.msg_control = control;
+                message.msg_controllen = sizeof(control);
+                if (recvmsg(connection, &message, MSG_WAITALL | MSG_CMSG_CLOEXEC) != sizeof(header))
+                    return {};
+                auto cmsg = CMSG_FIRSTHDR(&message);
+                if (cmsg == nullptr || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(fds)))
+                    return {};
+                std::memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+                std::array<ysh::FileDescriptor, 3> received{ysh::FileDescriptor{fds[0]}, ysh::FileDescriptor{fds[1]},
+                                                            ysh::FileDescriptor{fds[2]}};
+                if (header.magic != RequestMagic || header.length > MaxRequestLength || header.argc == 0)
+                    return {};
+
+                std::string payload(header.length, '\0');
+                if (!readAll(connection, payload.data(), payload.size()))
+                    return {};
+                std::vector<std::size_t> offsets{};
+                for (std::size_t first = 0; first < payload.size();) {
+                    auto end = payload.find('\0', first);
+                    if (end == std::string::npos)
+                        return {};
+                    offsets.push_back(first);
+                    first = end + 1;
+                }
+                if (offsets.size() != 1 + header.argc + header.envc)
+                    return {};
+
+                std::int32_t self = getpid();
+                char go{};
+                if (!writeAll(connection, &self, sizeof(self)) || !readAll(connection, &go, 1) || go != 'G')
+                    return {};
+
+                clearenv();
+                mPayload = std::move(payload);
+                mArgs.clear();
+                for (std::size_t idx = 1; idx <= header.argc; ++idx)
+                    mArgs.emplace_back(mPayload.c_str() + offsets[idx]);
+                for (std::size_t idx = 1 + header.argc; idx < offsets.size(); ++idx)
+                    putenv(mPayload.data() + offsets[idx]);
+                if (chdir(mPayload.c_str()) != 0)
+                    return {};
+                discardInput();
+                for (int target = 0; target < 3; ++target)
+                    dup2(received[static_cast<std::size_t>(target)].get(), target);
+                return mArgs;
+            }
+
+            /**
+             * @brief Drop standard input read ahead from an invocation, so the next one can not read it.
+             * @details Covers stdio, which std::cin reads through by default, and the buffer of std::cin
+             * itself when the program turned off sync_with_stdio(). Call with /dev/null or the next
+             * invocation's stdin in place, so nothing more is read from the last one.
+             */
+            static void discardInput() {
+                __fpurge(stdin);
+                std::clearerr(stdin);
+                std::cin.clear();
+                if (auto buffered = std::cin.rdbuf()->in_avail(); buffered > 0)
+                    std::cin.ignore(buffered);
+                std::cin.clear();
+            }
+
+            /**
+             * @brief Flush output to the invocation and return to the idle context.
+             */
+            static void release(int null) {
+                std::cout.flush();
+                std::cerr.flush();
+                std::fflush(nullptr);
+                for (int target = 0; target < 3; ++target)
+                    dup2(null, target);
+                discardInput();
+                std::cout.clear();
+                std::cerr.clear();
+                [[maybe_unused]] auto root = chdir("/");
+            }
+        };
+
+        /**
+         * @brief Become the server for an address. Never returns.
+         * @details Requests are served one at a time, start() runs in the server itself so whatever it set up
+         * in earlier requests is already there. An invocation that finds the server busy runs start() itself.
+         */
+        [[noreturn]] void serve(const sockaddr_un &address, long idleSeconds) {
+            setsid();
+            // Let go of everything inherited from the first invocation, a pipe held open would keep its reader
+            // waiting for the server to exit.
+            close_range(3, ~0u, 0);
+            ysh::FileDescriptor null{open("/dev/null", O_RDWR | O_CLOEXEC)};
+            for (int target = 0; target < 3; ++target)
+                dup2(null.get(), target);
+            // An invocation that was killed leaves nobody to read its output or exit status.
+            signal(SIGPIPE, SIG_IGN);
+
+            // The lock decides which of several racing first invocations serves.
+            auto lockPath = ysh::StringComposite(std::string_view{address.sun_path}, ".lock");
+            ysh::FileDescriptor lock{open(lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600)};
+            if (!lock || flock(lock.get(), LOCK_EX | LOCK_NB) != 0)
+                _exit(0);
+            unlink(address.sun_path);
+            ysh::FileDescriptor listener{socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+            if (!listener || bind(listener.get(), reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0
+                || listen(listener.get(), SOMAXCONN) != 0)
+                _exit(1);
+
+            Context context{};
+            for (;;) {
+                pollfd listening{listener.get(), POLLIN, 0};
+                if (poll(&listening, 1, static_cast<int>(idleSeconds * 1000)) == 0)
+                    break;
+                ysh::FileDescriptor connection{accept4(listener.get(), nullptr, nullptr, SOCK_CLOEXEC)};
+                if (!connection)
+                    continue;
+                ucred peer{};
+                socklen_t peerSize = sizeof(peer);
+                if (getsockopt(connection.get(), SOL_SOCKET, SO_PEERCRED, &peer, &peerSize) != 0
+                    || peer.uid != getuid())
+                    continue;
+                // A stalled invocation may not hold up the others.
+                timeval receiveTimeout{1, 0};
+                setsockopt(connection.get(), SOL_SOCKET, SO_RCVTIMEO, &receiveTimeout, sizeof(receiveTimeout));
+
+                auto args = context.adopt(connection.get());
+                std::int32_t status = args.empty() ? 1 : start(args);
+                Context::release(null.get());
+                if (!args.empty())
+                    writeAll(connection.get(), &status, sizeof(status));
+            }
+            unlink(address.sun_path);
+            unlink(lockPath.c_str());
+            _exit(0);
+        }
+
+        /**
+         * @brief Run an invocation in the resident server, starting the server if there is none.
+         * @return The exit status, or std::nullopt if the invocation must run start() itself.
+         */
+        std::optional<int> resident(const char *idleValue, int argc, char const *const *argv) {
+            auto address = residentAddress(argc > 0 ? argv[0] : "");
+            if (!address)
+                return std::nullopt;
+            ysh::FileDescriptor connection{socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+            if (!connection)
+                return std::nullopt;
+            if (connect(connection.get(), reinterpret_cast<const sockaddr *>(&*address), sizeof(*address)) == 0)
+                return request(connection.get(), argc, argv);
+            if (errno != ENOENT && errno != ECONNREFUSED)
+                return std::nullopt;
+
+            connection.reset();
+            long idleSeconds{DefaultIdleSeconds};
+            if (auto [ptr, ec] = std::from_chars(idleValue, idleValue + std::strlen(idleValue), idleSeconds);
+                    ec != std::errc() || idleSeconds <= 0)
+                idleSeconds = DefaultIdleSeconds;
+            // Nothing else has run yet, the server starts as a copy of a freshly loaded program.
+            if (fork() == 0)
+                serve(*address, idleSeconds);
+            return std::nullopt;
+        }
+    }
+
+} // better_main
 
 int main(const int argc, char const * const * const argv) {
+    if (auto idle = getenv(better_main::ResidentEnvVar.data()))
+        if (auto status = better_main::resident(idle, argc, argv))
+            return *status;
     std::vector<std::string_view> args(argv, std::next(argv, static_cast<std::ptrdiff_t>(argc)));
     return better_main::start(args);
 }
-
-namespace better_main {
-} // better_main
\ No newline at end of file
@@ -14,6 +14,7 @@
 #ifndef VE3YSH_UTIL_BMAIN_H
 #define VE3YSH_UTIL_BMAIN_H
 
+#include <cstdint>
 #include <span>
 #include <string_view>
 #include <vector>
@@ -21,8 +22,11 @@
 #include <filesystem>
 #include <iostream>
 #include <exception>
+#include <expected>
+#include <new>
 #include <ranges>
 #include <StringComposite.h>
+#include <Metrics.h>
 #include <algorithm>
 
 namespace better_main {
@@ -36,6 +40,23 @@ namespace better_main {
      */
     [[nodiscard]] int start(std::span<const std::string_view>) noexcept;
 
+    /**
+     * @brief The environment variable that opts a program into resident server mode.
+     * @details When it is set and XDG_RUNTIME_DIR names a directory, main() connects to a server for the
+     * program on a Unix socket in XDG_RUNTIME_DIR. If there is none, the invocation forks one and runs
+     * start() itself. Later invocations pass their arguments, working directory, environment and standard
+     * file descriptors to the server with SCM_RIGHTS, and the server runs start() with them and returns the
+     * exit status. Requests run one at a time inside the server, so anything start() caches is there for the
+     * next one. An invocation that finds the server busy runs start() itself.
+     *
+     * A program that opts in must return from start() rather than call exit(), and must not depend on state
+     * left by an earlier request, including anything it derived from that request's environment. Signals the
+     * invocation receives are forwarded to the server, without a handler they end the server along with the
+     * request. The value is the number of idle seconds after which the server exits, 600 if it is not a
+     * number. The socket name identifies the executable file, so a rebuilt program gets a new server.
+     */
+    inline constexpr std::string_view ResidentEnvVar{"BETTER_MAIN_RESIDENT"};
+
     /**
      * @enum ArgType
      * @brief The type of the associated value of the option.
@@ -82,7 +103,7 @@ namespace better_main {
      */
     template<class Range, class Enum>
     requires std::ranges::range<Range> && std::is_enum_v<Enum>
-    [[maybe_unused]] auto findOption(const Range args, Enum arg) {
+    [[maybe_unused]] auto findOption(const Range& args, Enum arg) {
         return std::ranges::find_if(args, [&arg](auto opt) {
             return opt.argIdx == arg;
         });
@@ -97,7 +118,7 @@ namespace better_main {
      */
     template<class Range>
     requires std::ranges::range<Range>
-    [[maybe_unused]] auto findOption(const Range args, char arg) {
+    [[maybe_unused]] auto findOption(const Range& args, char arg) {
         return std::ranges::find_if(args, [&arg](auto opt) {
             return opt.shortArg == arg;
         });
@@ -112,7 +133,7 @@ namespace better_main {
      */
     template<class Range, class String>
     requires std::ranges::range<Range> && (std::is_same_v<String,std::string> || std::is_same_v<String,std::string_view>)
-    auto findOption(const Range args, const String& arg) {
+    auto findOption(const Range& args, const String& arg) {
         return std::ranges::find_if(args, [&arg](auto opt) { return opt.longArg == arg; });
     }
 
@@ -159,6 +180,7 @@ namespace better_main {
     class ArgParseError : public std::runtime_error {
     public:
         explicit ArgParseError(const std::string& whatArg) : std::runtime_error(whatArg) {}
+        explicit ArgParseError(const char* whatArg) : std::runtime_error(whatArg) {}
     };
 
     /**
@@ -299,20 +321,71 @@ complete -o filenames -F _)" << programName << R"(_completions )" << programName
     }
 
     /**
-     * @brief Parse command line arguments into an Invocation structure.
+     * @enum ParseErrorCode
+     * @brief The reason command line parsing failed.
+     */
+    enum class ParseErrorCode : std::uint8_t {
+        UnknownLongOption,      ///< A long option is not in the option array.
+        UnknownShortOption,     ///< A short option is not in the option array.
+        MultipleValues,         ///< More than one option in a short option group takes a value.
+        MissingValue,           ///< An option that takes a value is the last argument.
+    };
+
+    /**
+     * @struct ParseError
+     * @brief A command line parsing error, returned by the non-throwing parseArgs().
+     * @details The error holds views into the arguments passed to start() and the option array, both of which
+     * outlive it, so it is trivially copyable. The message is only composed when message() is called.
+     */
+    struct ParseError {
+        ParseErrorCode code{};      ///< The reason for the error.
+        char optionChar{};          ///< The offending short option, for UnknownShortOption.
+        std::uint32_t tokenIndex{}; ///< The index in the arguments of the offending token.
+        std::string_view token{};   ///< The offending token, or for MissingValue the long option name.
+
+        /**
+         * @brief Compose the error message.
+         */
+        [[nodiscard]] std::string message() const {
+            switch (code) {
+                case ParseErrorCode::UnknownLongOption:
+                    return ysh::StringComposite("Command line option '", token, "' not found.");
+                case ParseErrorCode::UnknownShortOption:
+                    return ysh::StringComposite("Command line option '", optionChar, "' not found.");
+                case ParseErrorCode::MultipleValues:
+                    return ysh::StringComposite("In option '", token, "' more than one option takes an argument.");
+                case ParseErrorCode::MissingValue:
+                    return ysh::StringComposite("Command line option '", token,
+                                                "' takes a value but none is provided.");
+            }
+            return "Command line parsing error.";
+        }
+    };
+
+    /**
+     * @brief Parse command line arguments into an Invocation structure without throwing.
+     * @details Selected by passing std::nothrow. Suitable for programs built with -fno-exceptions, and for
+     * recovering from a bad command line inside the noexcept start().
      * @tparam Enum A user supplied enumeration that identifies options.
      * @tparam Size The size of the option array, deduced.
      * @param args The arguments provided to start().
      * @param argSpec The option array.
-     * @return An Invocation<Enum> structure with invocation observations.
-     * @throws ArgParseError.
+     * @return An Invocation<Enum> structure with invocation observations, or a ParseError.
      */
     template<class Enum, size_t Size>
-    Invocation<Enum> parseArgs(std::span<const std::string_view>& args, const std::array<BMainArg<Enum>,Size>& argSpec,
-                               bool longOptDoubleDash = true){
+    std::expected<Invocation<Enum>, ParseError> parseArgs(std::span<const std::string_view>& args,
+                                                          const std::array<BMainArg<Enum>,Size>& argSpec,
+                                                          const std::nothrow_t&, bool longOptDoubleDash = true){
         using ArgListIterator = std::array<BMainArg<Enum>,Size>::const_iterator;
+        static auto &parseTime = ysh::MetricsRegistry::instance().histogram("bmain.parse_args_ns");
+        ysh::ScopedTimer timer{parseTime};
         bool doubleDash{false};
 
+        // The index of a token in args, the program path is index 0.
+        auto error = [](ParseErrorCode code, size_t idx, std::string_view token, char optionChar = '\0') {
+            return std::unexpected(ParseError{code, optionChar, static_cast<std::uint32_t>(idx + 1), token});
+        };
+
         // Create the return Invocation object, set the program path and set the sub-span to the remainder.
         Invocation<Enum> invocation{};
         invocation.programPath = args.front();
@@ -339,7 +412,7 @@ complete -o filenames -F _)" << programName << R"(_completions )" << programName
                                 else
                                     invocation.emplace_back(argItem->argIdx, argItem->argType, "");
                             } else {
-                                throw ArgParseError("Command line option not found.");
+                                return error(ParseErrorCode::UnknownLongOption, idx, argString);
                             }
                         }
                     } else { //Short option
@@ -353,28 +426,29 @@ complete -o filenames -F _)" << programName << R"(_completions )" << programName
                                             valuedOption = argItem;
                                             valueUsed = true;
                                         } else { // otherwise it is an error
-                                            throw ArgParseError(ysh::StringComposite("In option '", argString,
-                                                                                     "' more than one option takes an argument."));
+                                            return error(ParseErrorCode::MultipleValues, idx, argString);
                                         }
                                     } else { // When the option does not take an argument it is just note on the list.
                                         invocation.emplace_back(argItem->argIdx, argItem->argType, "");
                                     }
                                 } else {
-                                    throw ArgParseError(
-                                            ysh::StringComposite("Command line option '", argChar, "' not found."));
+                                    return error(ParseErrorCode::UnknownShortOption, idx, argString, argChar);
                                 }
                             }
                         }
                     }
 
                     if (valuedOption != argSpec.end()) { // A deferred option that takes a value.
-                        if (argList.size() > idx + 1) { // Is the a value available?
+                        if (valuedOption->argType == ArgType::Help &&
+                                (argList.size() <= idx + 1 || argList[idx + 1].starts_with('-'))) {
+                            // The help option value is optional.
+                            invocation.emplace_back(valuedOption->argIdx, valuedOption->argType, "");
+                        } else if (argList.size() > idx + 1) { // Is the a value available?
                             ++idx; // Yes, point to it and note on the list.
                             invocation.push_back(BMainArgValue<Enum>{valuedOption->argIdx, valuedOption->argType,
                                                                      std::string{argList[idx]}});
                         } else {
-                            throw ArgParseError(ysh::StringComposite("Command line option '", valuedOption->longArg,
-                                                                     "' takes a value but none is provided."));
+                            return error(ParseErrorCode::MissingValue, idx, valuedOption->longArg);
                         }
                     }
                 } else { // An embedded free argument.
@@ -385,6 +459,24 @@ complete -o filenames -F _)" << programName << R"(_completions )" << programName
         return invocation;
     }
 
+    /**
+     * @brief Parse command line arguments into an Invocation structure.
+     * @tparam Enum A user supplied enumeration that identifies options.
+     * @tparam Size The size of the option array, deduced.
+     * @param args The arguments provided to start().
+     * @param argSpec The option array.
+     * @return An Invocation<Enum> structure with invocation observations.
+     * @throws ArgParseError.
+     */
+    template<class Enum, size_t Size>
+    Invocation<Enum> parseArgs(std::span<const std::string_view>& args, const std::array<BMainArg<Enum>,Size>& argSpec,
+                               bool longOptDoubleDash = true){
+        auto invocation = parseArgs(args, argSpec, std::nothrow, longOptDoubleDash);
+        if (!invocation)
+            throw ArgParseError(invocation.error().message());
+        return std::move(*invocation);
+    }
+
     /**
      * @brief Count the number of occurrences of an option in the invocation.
      * @tparam Enum A user supplied enumeration that identifies options.
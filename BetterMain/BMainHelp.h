@@ -0,0 +1,405 @@
+/*
+ * BMainHelp.h Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file BMainHelp.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Help text rendered from the option array at compile time.
+ * @details Help<ProgramArgs> renders a column aligned option summary and one page per option, from the
+ * shortHelp and longHelp of each BMainArg, into static character arrays while compiling. Printing help is
+ * then a single write(2). generateManPage() writes the matching man page.
+ */
+
+#ifndef VE3YSH_UTIL_BMAINHELP_H
+#define VE3YSH_UTIL_BMAINHELP_H
+
+#include <unistd.h>
+#include <array>
+#include <cctype>
+#include <ostream>
+#include <string_view>
+#include <utility>
+#include "BMain.h"
+
+namespace better_main {
+
+    namespace help {
+
+        static constexpr std::size_t LineWidth = 80;
+
+        /**
+         * @brief The placeholder written after an option for its value.
+         */
+        constexpr std::string_view placeholder(ArgType argType) {
+            switch (argType) {
+                case ArgType::Help:
+                    return "[option]";
+                case ArgType::String:
+                    return "<string>";
+                case ArgType::Integer:
+                    return "<integer>";
+                case ArgType::Float:
+                    return "<number>";
+                case ArgType::Path:
+                    return "<path>";
+                case ArgType::Host:
+                    return "<host>";
+                case ArgType::User:
+                    return "<user>";
+                case ArgType::Group:
+                    return "<group>";
+                default:
+                    return "";
+            }
+        }
+
+        /**
+         * @struct Measure
+         * @brief A renderer output that only counts characters, used to size the Buffer.
+         */
+        struct Measure {
+            std::size_t size{0};
+
+            constexpr void put(char) { ++size; }
+
+            constexpr void put(std::string_view text) { size += text.size(); }
+        };
+
+        /**
+         * @struct Buffer
+         * @brief A renderer output that stores characters.
+         */
+        template<std::size_t Size>
+        struct Buffer {
+            std::array<char, Size> data{};
+            std::size_t size{0};
+
+            constexpr void put(char c) { data[size++] = c; }
+
+            constexpr void put(std::string_view text) {
+                for (auto c : text)
+                    put(c);
+            }
+        };
+
+        template<class Out>
+        constexpr void spaces(Out &out, std::size_t count) {
+            for (std::size_t i = 0; i < count; ++i)
+                out.put(' ');
+        }
+
+        /**
+         * @brief Write the option label, for example: -o, --output <path>
+         * @param align Indent long only options to line up with options that have a short form.
+         */
+        template<class Out, class Arg>
+        constexpr void label(Out &out, const Arg &arg, bool longOptDoubleDash, bool align = true) {
+            if (arg.shortArg != '\0') {
+                out.put('-');
+                out.put(arg.shortArg);
+                if (!arg.longArg.empty())
+                    out.put(", ");
+            } else if (align) {
+                spaces(out, 4);
+            }
+            if (!arg.longArg.empty()) {
+                out.put(longOptDoubleDash ? "--" : "-");
+                out.put(arg.longArg);
+            }
+            if (auto value = placeholder(arg.argType); !value.empty()) {
+                out.put(' ');
+                out.put(value);
+            }
+        }
+
+        template<class Arg>
+        constexpr std::size_t labelWidth(const Arg &arg, bool longOptDoubleDash) {
+            Measure measure{};
+            label(measure, arg, longOptDoubleDash);
+            return measure.size;
+        }
+
+        /**
+         * @brief Write text filled to LineWidth, continuation lines indented.
+         * @param column The column the text starts at.
+         * @param indent The column continuation lines start at.
+         */
+        template<class Out>
+        constexpr void wrap(Out &out, std::string_view text, std::size_t column, std::size_t indent) {
+            bool lineStart = true;
+            while (!text.empty()) {
+                if (text.front() == '\n') {
+                    out.put('\n');
+                    spaces(out, indent);
+                    column = indent;
+                    lineStart = true;
+                    text.remove_prefix(1);
+                    continue;
+                }
+                if (text.front() == ' ') {
+                    text.remove_prefix(1);
+                    continue;
+                }
+                auto length = std::min(text.find_first_of(" \n"), text.size());
+                if (!lineStart && column + 1 + length > LineWidth) {
+                    out.put('\n');
+                    spaces(out, indent);
+                    column = indent;
+                } else if (!lineStart) {
+                    out.put(' ');
+                    ++column;
+                }
+                out.put(text.substr(0, length));
+                column += length;
+                lineStart = false;
+                text.remove_prefix(length);
+            }
+        }
+
+        /**
+         * @brief Render the option summary.
+         */
+        template<class Out, class Spec>
+        constexpr void usage(Out &out, const Spec &spec, bool longOptDoubleDash) {
+            std::size_t width = 0;
+            for (const auto &arg : spec)
+                if (arg.argType != ArgType::FreeArg)
+                    width = std::max(width, labelWidth(arg, longOptDoubleDash));
+            auto column = width + 4;
+
+            out.put("Options:\n");
+            for (const auto &arg : spec) {
+                if (arg.argType == ArgType::FreeArg)
+                    continue;
+                spaces(out, 2);
+                label(out, arg, longOptDoubleDash);
+                if (!arg.shortHelp.empty()) {
+                    spaces(out, column - 2 - labelWidth(arg, longOptDoubleDash));
+                    wrap(out, arg.shortHelp, column, column);
+                }
+                out.put('\n');
+            }
+        }
+
+        /**
+         * @brief Render the help page of one option.
+         */
+        template<class Out, class Arg>
+        constexpr void page(Out &out, const Arg &arg, bool longOptDoubleDash) {
+            if (arg.argType == ArgType::FreeArg)
+                return;
+            label(out, arg, longOptDoubleDash, false);
+            out.put('\n');
+            if (!arg.shortHelp.empty()) {
+                spaces(out, 4);
+                wrap(out, arg.shortHelp, 4, 4);
+                out.put('\n');
+            }
+            if (!arg.longHelp.empty()) {
+                out.put('\n');
+                spaces(out, 4);
+                wrap(out, arg.longHelp, 4, 4);
+                out.put('\n');
+            }
+        }
+
+        /**
+         * @brief Write all of a string to a file descriptor, normally in one write(2).
+         */
+        inline bool writeAll(int fd, std::string_view text) {
+            while (!text.empty()) {
+                auto count = ::write(fd, text.data(), text.size());
+                if (count < 0)
+                    return false;
+                text.remove_prefix(static_cast<std::size_t>(count));
+            }
+            return true;
+        }
+
+    } // help
+
+    /**
+     * @class Help
+     * @brief The help text for an option array, rendered at compile time.
+     * @tparam Spec The option array, a static constexpr std::array of BMainArg.
+     * @tparam LongOptDoubleDash As passed to parseArgs().
+     */
+    template<auto &Spec, bool LongOptDoubleDash = true>
+    class Help {
+    private:
+        static constexpr std::size_t OptionCount = std::tuple_size_v<std::remove_cvref_t<decltype(Spec)>>;
+
+        static consteval std::size_t usageSize() {
+            help::Measure measure{};
+            help::usage(measure, Spec, LongOptDoubleDash);
+            return measure.size;
+        }
+
+        static consteval auto renderUsage() {
+            help::Buffer<usageSize()> buffer{};
+            help::usage(buffer, Spec, LongOptDoubleDash);
+            return buffer.data;
+        }
+
+        static consteval std::size_t pagesSize() {
+            help::Measure measure{};
+            for (const auto &arg : Spec)
+                help::page(measure, arg, LongOptDoubleDash);
+            return measure.size;
+        }
+
+        static consteval auto renderPages() {
+            help::Buffer<pagesSize()> buffer{};
+            for (const auto &arg : Spec)
+                help::page(buffer, arg, LongOptDoubleDash);
+            return buffer.data;
+        }
+
+        static consteval auto renderPageIndex() {
+            std::array<std::pair<std::size_t, std::size_t>, OptionCount> index{};
+            help::Measure measure{};
+            for (std::size_t idx = 0; idx < OptionCount; ++idx) {
+                auto offset = measure.size;
+                help::page(measure, Spec[idx], LongOptDoubleDash);
+                index[idx] = {offset, measure.size - offset};
+            }
+            return index;
+        }
+
+        static constexpr auto UsageText = renderUsage();
+        static constexpr auto PageText = renderPages();
+        static constexpr auto PageIndex = renderPageIndex();
+
+    public:
+        /**
+         * @brief The option summary.
+         */
+        static constexpr std::string_view usage() { return {UsageText.data(), UsageText.size()}; }
+
+        /**
+         * @brief The help page of the option at an index in the option array.
+         */
+        static constexpr std::string_view page(std::size_t idx) {
+            return std::string_view{PageText.data(), PageText.size()}.substr(PageIndex[idx].first,
+                                                                            PageIndex[idx].second);
+        }
+
+        /**
+         * @brief Write the option summary.
+         */
+        static bool print(int fd = STDOUT_FILENO) { return help::writeAll(fd, usage()); }
+
+        /**
+         * @brief Write the help page of an option given by long name or short character, with or without
+         * leading dashes. The option summary is written if no option matches.
+         */
+        static bool print(std::string_view option, int fd = STDOUT_FILENO) {
+            while (option.starts_with('-'))
+                option.remove_prefix(1);
+            for (std::size_t idx = 0; idx < OptionCount && !option.empty(); ++idx) {
+                const auto &arg = Spec[idx];
+                if (arg.argType != ArgType::FreeArg &&
+                    (arg.longArg == option || (option.size() == 1 && arg.shortArg == option.front())))
+                    return help::writeAll(fd, page(idx));
+            }
+            return print(fd);
+        }
+
+        /**
+         * @brief Write the help requested on the command line, if any.
+         * @return true if the invocation contained a help option.
+         */
+        template<class Enum>
+        static bool print(const Invocation<Enum> &invocation, int fd = STDOUT_FILENO) {
+            for (const auto &arg : invocation) {
+                if (arg.argType == ArgType::Help) {
+                    if (arg.value.empty())
+                        print(fd);
+                    else
+                        print(arg.value, fd);
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    /**
+     * @brief Generate a man page from the option array.
+     * @tparam Enum A user supplied enumeration that identifies options.
+     * @tparam Size The number of options.
+     * @param programName The name of the program.
+     * @param summary The one line description for the NAME section.
+     * @param argSpec The options container.
+     * @param strm The ostream to write the man page to.
+     * @param section The manual section.
+     * https://man7.org/linux/man-pages/man7/man-pages.7.html
+     */
+    template<class Enum, size_t Size>
+    void generateManPage(std::string_view programName, std::string_view summary,
+                         const std::array<BMainArg<Enum>,Size>& argSpec, std::ostream& strm, int section = 1,
+                         bool longOptDoubleDash = true) {
+        // Help text is copied as roff text: a backslash is written as \e, a hyphen as \-, and a line that
+        // would start with a control character is protected with \& so it is not read as a request.
+        auto escaped = [&strm](std::string_view text) {
+            bool lineStart = true;
+            for (auto c : text) {
+                if (lineStart && (c == '.' || c == '\''))
+                    strm << "\\&";
+                if (c == '\\')
+                    strm << "\\e";
+                else if (c == '-')
+                    strm << "\\-";
+                else
+                    strm << c;
+                lineStart = c == '\n';
+            }
+        };
+
+        strm << ".TH ";
+        for (auto c : programName)
+            strm << static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        strm << ' ' << section << "\n.SH NAME\n";
+        escaped(programName);
+        strm << " \\- ";
+        escaped(summary);
+        strm << "\n.SH SYNOPSIS\n.B ";
+        escaped(programName);
+        strm << "\n[\\fIoptions\\fR] [\\fIarguments\\fR]\n.SH OPTIONS\n";
+
+        for (const auto& arg : argSpec) {
+            if (arg.argType == ArgType::FreeArg)
+                continue;
+            strm << ".TP\n";
+            if (arg.shortArg != '\0') {
+                strm << "\\fB\\-" << arg.shortArg << "\\fR";
+                if (!arg.longArg.empty())
+                    strm << ", ";
+            }
+            if (!arg.longArg.empty()) {
+                strm << "\\fB" << (longOptDoubleDash ? "\\-\\-" : "\\-");
+                escaped(arg.longArg);
+                strm << "\\fR";
+            }
+            if (auto value = help::placeholder(arg.argType); !value.empty()) {
+                strm << " \\fI";
+                escaped(value);
+                strm << "\\fR";
+            }
+            strm << '\n';
+            escaped(arg.shortHelp);
+            strm << '\n';
+            if (!arg.longHelp.empty()) {
+                strm << ".IP\n";
+                escaped(arg.longHelp);
+                strm << '\n';
+            }
+        }
+    }
+
+} // better_main
+
+#endif //VE3YSH_UTIL_BMAINHELP_H
@@ -5,11 +5,79 @@
  * @date 2021-09-02
  */
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cctype>
+#include <deque>
+#include <future>
 #include <iostream>
 #include <functional>
 #include <optional>
+#include <FileDescriptor.h>
+#include <Metrics.h>
+#include <ObjectPool.h>
+#include <ThreadPool.h>
 #include "ConfigFile.h"
 
+namespace {
+    constexpr std::size_t MinChunkSize = 256 * 1024;
+    constexpr std::size_t MaxChunkSize = 8 * 1024 * 1024;
+
+    using Match = std::pair<std::size_t, std::string_view>;
+
+    /**
+     * @brief Match each line of a block of text against the specs, as process() matches the lines it reads.
+     */
+    template<class Sink>
+    void parseLines(std::string_view text, const std::vector<ConfigFile::Spec> &configSpecs, Sink &&sink) {
+        while (!text.empty()) {
+            auto end = text.find('\n');
+            auto line = text.substr(0, end);
+            text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+            if (!line.empty() && line.front() == '#')
+                continue;
+            for (auto &spec : configSpecs) {
+                if (line.starts_with(spec.mKey)) {
+                    auto n = spec.mKey.size();
+                    while (n < line.size() && std::isspace(static_cast<unsigned char>(line[n])))
+                        ++n;
+                    sink(spec.mIdx, line.substr(n));
+                    break;
+                }
+            }
+        }
+    }
+
+    /**
+     * @class Mapping
+     * @brief A read only mapping of a whole file, unmapped on destruction.
+     */
+    class Mapping {
+    private:
+        void *mData{MAP_FAILED};
+        std::size_t mSize{0};
+
+    public:
+        Mapping(int fd, std::size_t size) : mData(mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)), mSize(size) {
+            if (mData != MAP_FAILED)
+                madvise(mData, mSize, MADV_SEQUENTIAL);
+        }
+
+        Mapping(const Mapping &) = delete;
+        Mapping &operator=(const Mapping &) = delete;
+
+        ~Mapping() {
+            if (mData != MAP_FAILED)
+                munmap(mData, mSize);
+        }
+
+        explicit operator bool() const { return mData != MAP_FAILED; }
+
+        [[nodiscard]] std::string_view view() const { return {static_cast<const char *>(mData), mSize}; }
+    };
+}
+
 ConfigFile::Status ConfigFile::open() {
     if (std::filesystem::exists(mConfigFilePath)) {
         mIstrm.open(mConfigFilePath);
@@ -26,13 +94,16 @@ void ConfigFile::close() {
 }
 
 ConfigFile::Status ConfigFile::process(const std::vector<ConfigFile::Spec>& configSpecs, const std::function<void(std::size_t, const std::string_view&)>& callback) {
-    std::string line{};
+    static auto &processTime = ysh::MetricsRegistry::instance().histogram("config.process_ns");
+    ysh::ScopedTimer timer{processTime};
+    auto buffer = ysh::acquireBuffer();     // Keeps the line capacity from the last file processed.
+    auto &line = *buffer;
 
     while (std::getline(mIstrm, line)) {
         if (line[0] != '#') {
             for (auto &spec : configSpecs) {
                 if (auto n = matchKey(line.begin(), line.end(), spec.mKey); n != std::string::npos) {
-                    callback(spec.mIdx,std::string_view{line.substr(n)});
+                    callback(spec.mIdx,std::string_view{line}.substr(n));
                     break;
                 }
             }
@@ -42,6 +113,68 @@ ConfigFile::Status ConfigFile::process(const std::vector<ConfigFile::Spec>& conf
     return ConfigFile::OK;
 }
 
+ConfigFile::Status ConfigFile::processParallel(const std::vector<ConfigFile::Spec>& configSpecs,
+                                              const std::function<void(std::size_t, const std::string_view&)>& callback,
+                                              Delivery delivery, ysh::ThreadPool *pool) {
+    auto &threads = pool ? *pool : ysh::ThreadPool::instance();
+    std::streamoff start = mIstrm.is_open() ? static_cast<std::streamoff>(mIstrm.tellg()) : -1;
+    ysh::FileDescriptor fd{start < 0 ? -1 : ::open(mConfigFilePath.c_str(), O_RDONLY | O_CLOEXEC)};
+    struct stat status{};
+    if (!fd || fstat(fd.get(), &status) != 0 || status.st_size < start + static_cast<std::streamoff>(2 * MinChunkSize))
+        return process(configSpecs, callback);
+    Mapping mapping{fd.get(), static_cast<std::size_t>(status.st_size)};
+    if (!mapping)
+        return process(configSpecs, callback);
+
+    static auto &processTime = ysh::MetricsRegistry::instance().histogram("config.process_parallel_ns");
+    ysh::ScopedTimer timer{processTime};
+    mIstrm.seekg(0, std::ios::end);
+
+    // Cut after the first newline at or past each chunk size, every chunk holds whole lines.
+    auto text = mapping.view().substr(static_cast<std::size_t>(start));
+    auto chunkSize = std::clamp(text.size() / (threads.size() * 8), MinChunkSize, MaxChunkSize);
+    std::vector<std::string_view> chunks{};
+    while (!text.empty()) {
+        auto cut = text.size() > chunkSize ? text.find('\n', chunkSize - 1) : std::string_view::npos;
+        auto length = cut == std::string_view::npos ? text.size() : cut + 1;
+        chunks.push_back(text.substr(0, length));
+        text.remove_prefix(length);
+    }
+
+    if (delivery == Delivery::Unordered) {
+        threads.parallel_for(chunks, [&configSpecs, &callback](std::string_view chunk) {
+            parseLines(chunk, configSpecs, callback);
+        }, 1);
+        return ConfigFile::OK;
+    }
+
+    // The reorder buffer, chunks are parsed ahead while the front one is delivered.
+    auto parse = [&configSpecs](std::string_view chunk) {
+        std::vector<Match> matches{};
+        parseLines(chunk, configSpecs, [&matches](std::size_t idx, std::string_view value) {
+            matches.emplace_back(idx, value);
+        });
+        return matches;
+    };
+    auto window = threads.size() * 2 + 1;
+    std::deque<std::future<std::vector<Match>>> pending{};
+    try {
+        for (std::size_t next = 0; next < chunks.size() || !pending.empty(); pending.pop_front()) {
+            for (; next < chunks.size() && pending.size() < window; ++next)
+                pending.push_back(threads.submit([&parse, chunk = chunks[next]] { return parse(chunk); }));
+            for (auto &[idx, value] : pending.front().get())
+                callback(idx, value);
+        }
+    } catch (...) {
+        // Tasks still running hold views of the mapping.
+        for (auto &future : pending)
+            if (future.valid())
+                future.wait();
+        throw;
+    }
+    return ConfigFile::OK;
+}
+
 std::string::size_type
 ConfigFile::matchKey(const std::string::iterator first, const std::string::iterator last, const std::string_view &key) {
     auto idx = first;
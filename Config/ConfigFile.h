@@ -19,6 +19,10 @@
 #include <cstring>
 #include <optional>
 
+namespace ysh {
+    class ThreadPool;
+}
+
 /**
  * @class ConfigFile
  * @brief
@@ -31,6 +35,14 @@ public:
         OPEN_FAIL,
     };
 
+    /**
+     * @brief How processParallel() delivers values to the callback.
+     */
+    enum class Delivery {
+        Ordered,    ///< On the calling thread in file order, as process() does.
+        Unordered,  ///< On the parsing threads, concurrently and in any order. The callback must be thread safe.
+    };
+
     struct Spec {
         std::string_view mKey{};
         std::size_t mIdx{};
@@ -60,6 +72,21 @@ public:
 
     Status process(const std::vector<ConfigFile::Spec>& configSpecs, const std::function<void(std::size_t, const std::string_view&)>& callback);
 
+    /**
+     * @brief Process the rest of a large file on several threads, matching lines as process() does.
+     * @details The file is mapped and cut into chunks of whole lines which are parsed on the pool, the calling
+     * thread delivers Ordered values through a reorder buffer holding a few chunks per worker. A file too small
+     * to cut into two chunks is given to process(). Ordered delivery waits on the pool, so it must not be
+     * called from a task running on a pool with a single worker.
+     * @param configSpecs The keys to match.
+     * @param callback Called with the spec index and value of each matching line.
+     * @param delivery Ordered or Unordered.
+     * @param pool The pool to parse on, nullptr for ysh::ThreadPool::instance().
+     */
+    Status processParallel(const std::vector<ConfigFile::Spec>& configSpecs,
+                           const std::function<void(std::size_t, const std::string_view&)>& callback,
+                           Delivery delivery = Delivery::Ordered, ysh::ThreadPool *pool = nullptr);
+
     void close();
 
     template<typename T>
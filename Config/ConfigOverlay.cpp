@@ -0,0 +1,71 @@
+/**
+ * @file ConfigOverlay.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2026-10-19
+ */
+
+#include <sys/stat.h>
+#include "ConfigOverlay.h"
+
+ConfigOverlay::ConfigOverlay(std::vector<ConfigFile::Spec> specs) : mSpecs(std::move(specs)) {
+    for (const auto &spec : mSpecs) {
+        mKeys.emplace(spec.mKey, spec.mIdx);
+        mIndexCount = std::max(mIndexCount, spec.mIdx + 1);
+    }
+}
+
+void ConfigOverlay::load(std::vector<std::filesystem::path> layers) {
+    mLayers = std::move(layers);
+    reload();
+}
+
+void ConfigOverlay::reload() {
+    mMerged.assign(mIndexCount, nullptr);
+    mSource.assign(mIndexCount, NoLayer);
+
+    std::map<std::pair<dev_t, ino_t>, ParsedLayer> stale{};
+    std::swap(stale, mParsed);
+
+    for (std::size_t layerIdx = 0; layerIdx < mLayers.size(); ++layerIdx) {
+        struct stat statBuf{};
+        if (stat(mLayers[layerIdx].c_str(), &statBuf) != 0 || !S_ISREG(statBuf.st_mode))
+            continue;
+
+        FileIdentity identity{statBuf.st_dev, statBuf.st_ino, statBuf.st_size,
+                              static_cast<std::int64_t>(statBuf.st_mtim.tv_sec) * 1000000000 + statBuf.st_mtim.tv_nsec};
+        auto memoKey = std::make_pair(identity.device, identity.inode);
+
+        // Reuse the parse if the file is unchanged, otherwise parse it again.
+        auto parsed = mParsed.find(memoKey);
+        if (parsed == mParsed.end()) {
+            if (auto old = stale.find(memoKey); old != stale.end() && old->second.identity == identity) {
+                parsed = mParsed.insert(stale.extract(old)).position;
+            } else {
+                ParsedLayer layer{identity, std::vector<std::optional<std::string>>(mIndexCount)};
+                ConfigFile configFile{mLayers[layerIdx]};
+                if (configFile.open() != ConfigFile::OK)
+                    continue;
+                configFile.process(mSpecs, [&layer](std::size_t idx, const std::string_view &value) {
+                    layer.values[idx] = std::string{value};
+                });
+                configFile.close();
+                ++mParseCount;
+                parsed = mParsed.emplace(memoKey, std::move(layer)).first;
+            }
+        }
+
+        for (std::size_t idx = 0; idx < mIndexCount; ++idx) {
+            if (parsed->second.values[idx]) {
+                mMerged[idx] = &parsed->second.values[idx].value();
+                mSource[idx] = layerIdx;
+            }
+        }
+    }
+}
+
+void ConfigOverlay::process(const std::function<void(std::size_t, const std::string_view &)> &callback) const {
+    for (std::size_t idx = 0; idx < mMerged.size(); ++idx)
+        if (mMerged[idx])
+            callback(idx, *mMerged[idx]);
+}
@@ -0,0 +1,113 @@
+/**
+ * @file ConfigOverlay.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2026-10-19
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ConfigFile.h"
+
+/**
+ * @class ConfigOverlay
+ * @brief A merged view of a stack of configuration files.
+ * @details Each layer is parsed with ConfigFile::process() and a value in a higher layer overrides the same
+ * key in all lower layers. Within one file the last occurrence of a key wins. Parsed layers are remembered by
+ * file identity (device, inode, size and mtime), so reload() only parses files that changed. Lookups by spec
+ * index or key are constant time.
+ */
+class ConfigOverlay {
+public:
+    /**
+     * @brief The layer index reported for a key no layer sets.
+     */
+    static constexpr std::size_t NoLayer = static_cast<std::size_t>(-1);
+
+protected:
+    struct FileIdentity {
+        dev_t device{};
+        ino_t inode{};
+        off_t size{};
+        std::int64_t mtime{};
+
+        bool operator==(const FileIdentity &) const = default;
+    };
+
+    struct ParsedLayer {
+        FileIdentity identity{};
+        std::vector<std::optional<std::string>> values{};   ///< Indexed by Spec::mIdx.
+    };
+
+    std::vector<ConfigFile::Spec> mSpecs{};
+    std::unordered_map<std::string_view, std::size_t> mKeys{};         ///< Key to Spec::mIdx.
+    std::size_t mIndexCount{0};
+
+    std::vector<std::filesystem::path> mLayers{};                       ///< Lowest priority first.
+    std::map<std::pair<dev_t, ino_t>, ParsedLayer> mParsed{};           ///< Memo by device and inode.
+    std::vector<const std::string *> mMerged{};                         ///< Indexed by Spec::mIdx.
+    std::vector<std::size_t> mSource{};                                 ///< Layer of each merged value.
+    std::size_t mParseCount{0};
+
+public:
+    ConfigOverlay() = delete;
+
+    explicit ConfigOverlay(std::vector<ConfigFile::Spec> specs);
+
+    /**
+     * @brief Set the layers and build the merged view.
+     * @param layers Configuration files, lowest priority first. Files that do not exist are skipped.
+     */
+    void load(std::vector<std::filesystem::path> layers);
+
+    /**
+     * @brief Rebuild the merged view, parsing only layers that changed since they were last parsed.
+     */
+    void reload();
+
+    /**
+     * @brief Get the merged value of a key by spec index.
+     */
+    [[nodiscard]] std::optional<std::string_view> value(std::size_t idx) const {
+        if (idx < mMerged.size() && mMerged[idx])
+            return std::string_view{*mMerged[idx]};
+        return std::nullopt;
+    }
+
+    /**
+     * @brief Get the merged value of a key.
+     */
+    [[nodiscard]] std::optional<std::string_view> value(std::string_view key) const {
+        if (auto found = mKeys.find(key); found != mKeys.end())
+            return value(found->second);
+        return std::nullopt;
+    }
+
+    /**
+     * @brief Get the index in the layer list of the file that supplied a value, or NoLayer.
+     */
+    [[nodiscard]] std::size_t source(std::size_t idx) const {
+        return idx < mSource.size() ? mSource[idx] : NoLayer;
+    }
+
+    /**
+     * @brief Deliver the merged values to a callback, in the style of ConfigFile::process().
+     */
+    void process(const std::function<void(std::size_t, const std::string_view&)>& callback) const;
+
+    /**
+     * @brief The number of times a file has been parsed, for verifying the memo.
+     */
+    [[nodiscard]] std::size_t parseCount() const { return mParseCount; }
+};
@@ -0,0 +1,114 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * ConfigOverlayTest.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file ConfigOverlayTest.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Check ConfigOverlay layer precedence and the parsed layer memo.
+ * @details Two configuration files are layered over each other with a missing third. Keys set by the upper
+ * layer must override the lower, reload() must not parse unchanged files, and a change to a file's size or
+ * only to its mtime must cause it to be parsed again.
+ */
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include "BetterMain/BMain.h"
+#include "Config/ConfigOverlay.h"
+
+namespace {
+
+    enum class Key : std::size_t {
+        Alpha, Beta, Gamma, Delta,
+    };
+
+    int failures = 0;
+
+    void expect(bool condition, std::string_view what) {
+        if (!condition) {
+            std::cerr << "Failed: " << what << '\n';
+            ++failures;
+        }
+    }
+
+    void write(const std::filesystem::path &path, std::string_view text) {
+        std::ofstream out{path, std::ios::trunc};
+        out << text;
+    }
+
+    bool valueIs(const ConfigOverlay &overlay, Key key, std::optional<std::string_view> expected) {
+        return overlay.value(static_cast<std::size_t>(key)) == expected;
+    }
+
+    std::size_t sourceOf(const ConfigOverlay &overlay, Key key) {
+        return overlay.source(static_cast<std::size_t>(key));
+    }
+}
+
+namespace better_main {
+    [[nodiscard]] int start(std::span<const std::string_view>) noexcept {
+        char templ[] = "/tmp/config-overlay-test-XXXXXX";
+        if (mkdtemp(templ) == nullptr) {
+            std::cerr << "Unable to make a test directory.\n";
+            return 1;
+        }
+        std::filesystem::path directory{templ};
+        auto system = directory / "system.conf";
+        auto user = directory / "user.conf";
+        write(system, "# System defaults\nalpha  one\nbeta  two\n");
+        write(user, "beta  three\ngamma  four\n");
+
+        try {
+            ConfigOverlay overlay{{{"alpha", Key::Alpha}, {"beta", Key::Beta}, {"gamma", Key::Gamma},
+                                   {"delta", Key::Delta}}};
+            overlay.load({system, user, directory / "missing.conf"});
+            expect(valueIs(overlay, Key::Alpha, "one") && sourceOf(overlay, Key::Alpha) == 0,
+                   "a key only the lower layer sets comes from it");
+            expect(valueIs(overlay, Key::Beta, "three") && sourceOf(overlay, Key::Beta) == 1,
+                   "the upper layer overrides the lower");
+            expect(overlay.value("gamma") == std::optional<std::string_view>{"four"}, "lookup by key");
+            expect(valueIs(overlay, Key::Delta, std::nullopt) && sourceOf(overlay, Key::Delta) == ConfigOverlay::NoLayer,
+                   "a key no layer sets has no value");
+            expect(overlay.parseCount() == 2, "each existing layer is parsed once");
+
+            overlay.reload();
+            expect(overlay.parseCount() == 2, "unchanged layers are not parsed again");
+
+            // A size change.
+            write(user, "beta  five\n");
+            overlay.reload();
+            expect(overlay.parseCount() == 3, "a layer whose size changed is parsed again");
+            expect(valueIs(overlay, Key::Beta, "five") && valueIs(overlay, Key::Gamma, std::nullopt),
+                   "the merged view follows the changed layer");
+
+            // The same size, only the mtime tells the change apart.
+            auto modified = std::filesystem::last_write_time(user);
+            write(user, "beta  sixx\n");
+            std::filesystem::last_write_time(user, modified + std::chrono::seconds{1});
+            overlay.reload();
+            expect(overlay.parseCount() == 4, "a layer whose mtime changed is parsed again");
+            expect(valueIs(overlay, Key::Beta, "sixx"), "the merged view follows the rewritten layer");
+            expect(valueIs(overlay, Key::Alpha, "one") && sourceOf(overlay, Key::Alpha) == 0,
+                   "the unchanged lower layer is kept");
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << '\n';
+            ++failures;
+        }
+
+        std::error_code ec{};
+        std::filesystem::remove_all(directory, ec);
+        std::cout << (failures ? "FAIL" : "PASS") << ": configuration overlay precedence and memo.\n";
+        return failures ? 1 : 0;
+    }
+}
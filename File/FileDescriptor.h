@@ -0,0 +1,68 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * FileDescriptor.h Created by Richard Buckley (C) 19/10/26
+ */
+
+#include <unistd.h>
+#include <utility>
+
+#ifndef YSH_FILEDESCRIPTOR_H
+#define YSH_FILEDESCRIPTOR_H
+
+namespace ysh {
+
+/**
+ * @class FileDescriptor
+ * @brief Sole owner of a POSIX file descriptor, closed on destruction.
+ */
+    class FileDescriptor {
+    private:
+        int mFd{-1};
+
+    public:
+        FileDescriptor() = default;
+
+        explicit FileDescriptor(int fd) : mFd(fd) {}
+
+        ~FileDescriptor() { reset(); }
+
+        FileDescriptor(const FileDescriptor &) = delete;
+        FileDescriptor &operator=(const FileDescriptor &) = delete;
+
+        FileDescriptor(FileDescriptor &&other) noexcept : mFd(other.release()) {}
+
+        FileDescriptor &operator=(FileDescriptor &&other) noexcept {
+            if (this != &other)
+                reset(other.release());
+            return *this;
+        }
+
+        /**
+         * @brief Test if a descriptor is held.
+         */
+        explicit operator bool() const { return mFd >= 0; }
+
+        [[nodiscard]] int get() const { return mFd; }
+
+        /**
+         * @brief Give up ownership without closing.
+         * @return The descriptor.
+         */
+        int release() { return std::exchange(mFd, -1); }
+
+        /**
+         * @brief Close the descriptor held, if any, and take ownership of another.
+         */
+        void reset(int fd = -1) {
+            if (mFd >= 0)
+                ::close(mFd);
+            mFd = fd;
+        }
+    };
+
+} // ysh
+
+#endif //YSH_FILEDESCRIPTOR_H
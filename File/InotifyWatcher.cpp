@@ -0,0 +1,112 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * InotifyWatcher.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <array>
+#include <cstring>
+#include "InotifyWatcher.h"
+
+namespace ysh {
+
+    const std::uint32_t InotifyWatcher::DefaultMask = IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                                      IN_DELETE_SELF | IN_MOVE_SELF;
+
+    InotifyWatcher::InotifyWatcher(Callback callback, std::uint32_t mask) : mCallback(std::move(callback)), mMask(mask) {
+        mInotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (mInotifyFd < 0)
+            return;
+
+        mWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (mWakeFd < 0) {
+            ::close(mInotifyFd);
+            mInotifyFd = -1;
+            return;
+        }
+
+        mThread = std::thread([this]() { run(); });
+    }
+
+    InotifyWatcher::~InotifyWatcher() {
+        if (mThread.joinable()) {
+            std::uint64_t one{1};
+            [[maybe_unused]] auto n = ::write(mWakeFd, &one, sizeof(one));
+            mThread.join();
+        }
+        if (mWakeFd >= 0)
+            ::close(mWakeFd);
+        if (mInotifyFd >= 0)
+            ::close(mInotifyFd);
+    }
+
+    bool InotifyWatcher::watch(const std::filesystem::path &directory) {
+        if (mInotifyFd < 0)
+            return false;
+
+        std::lock_guard<std::mutex> lock{mMutex};
+        if (mDirectories.contains(directory.native()))
+            return true;
+
+        auto wd = inotify_add_watch(mInotifyFd, directory.c_str(), mMask | IN_ONLYDIR);
+        if (wd < 0)
+            return false;
+
+        mWatches[wd] = directory;
+        mDirectories[directory.native()] = wd;
+        return true;
+    }
+
+    void InotifyWatcher::run() {
+        alignas(inotify_event) std::array<char, 4096> buffer{};
+        std::array<pollfd, 2> fds{{{mInotifyFd, POLLIN, 0}, {mWakeFd, POLLIN, 0}}};
+
+        while (true) {
+            if (poll(fds.data(), fds.size(), -1) < 0) {
+                if (errno == EINTR)
+                    continue;
+                return;
+            }
+            if (fds[1].revents)
+                return;
+
+            auto length = ::read(mInotifyFd, buffer.data(), buffer.size());
+            if (length <= 0)
+                continue;
+
+            for (auto ptr = buffer.data(); ptr < buffer.data() + length; ) {
+                inotify_event event{};
+                std::memcpy(&event, ptr, sizeof(event));
+                std::string_view name{ptr + sizeof(event), event.len ? std::strlen(ptr + sizeof(event)) : 0};
+                ptr += sizeof(event) + event.len;
+
+                if (event.mask & IN_Q_OVERFLOW) {
+                    mCallback(std::filesystem::path{}, std::string_view{});
+                    continue;
+                }
+
+                std::filesystem::path directory{};
+                {
+                    std::lock_guard<std::mutex> lock{mMutex};
+                    if (auto watch = mWatches.find(event.wd); watch != mWatches.end()) {
+                        directory = watch->second;
+                        if (event.mask & IN_IGNORED) {  // The watch was removed, the directory is gone.
+                            mDirectories.erase(directory.native());
+                            mWatches.erase(watch);
+                        }
+                    }
+                }
+
+                if (!directory.empty())
+                    mCallback(directory, name);
+            }
+        }
+    }
+
+} // ysh
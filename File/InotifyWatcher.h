@@ -0,0 +1,74 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * InotifyWatcher.h Created by Richard Buckley (C) 19/10/26
+ */
+
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#ifndef YSH_INOTIFYWATCHER_H
+#define YSH_INOTIFYWATCHER_H
+
+namespace ysh {
+
+/**
+ * @class InotifyWatcher
+ * @brief Watch directories for changes to their entries with inotify(7).
+ * @details Events are read on a background thread and passed to the callback on that thread. The callback
+ * receives the watched directory and the name of the entry that changed, or an empty name when the change
+ * was to the directory itself. When the kernel event queue overflows the callback receives an empty
+ * directory, meaning anything may have changed.
+ */
+    class InotifyWatcher {
+    public:
+        using Callback = std::function<void(const std::filesystem::path &directory, std::string_view name)>;
+
+        /**
+         * @brief The default events: changes to the existence, type or permissions of directory entries.
+         */
+        static const std::uint32_t DefaultMask;
+
+    private:
+        Callback mCallback{};
+        std::uint32_t mMask{};
+        int mInotifyFd{-1};
+        int mWakeFd{-1};
+        std::thread mThread{};
+        std::mutex mMutex{};
+        std::unordered_map<int, std::filesystem::path> mWatches{};      ///< Watch descriptor to directory.
+        std::unordered_map<std::string, int> mDirectories{};            ///< Directory to watch descriptor.
+
+        void run();
+
+    public:
+        explicit InotifyWatcher(Callback callback, std::uint32_t mask = DefaultMask);
+
+        ~InotifyWatcher();
+
+        InotifyWatcher(const InotifyWatcher &) = delete;
+        InotifyWatcher &operator=(const InotifyWatcher &) = delete;
+
+        /**
+         * @brief Test if inotify is available.
+         */
+        explicit operator bool() const { return mInotifyFd >= 0; }
+
+        /**
+         * @brief Start watching a directory, if it is not already watched.
+         * @param directory The directory.
+         * @return true if the directory is being watched.
+         */
+        bool watch(const std::filesystem::path &directory);
+    };
+
+} // ysh
+
+#endif //YSH_INOTIFYWATCHER_H
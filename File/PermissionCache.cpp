@@ -0,0 +1,192 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * PermissionCache.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+#include <sys/stat.h>
+#include <bit>
+#include "PermissionCache.h"
+
+namespace ysh {
+
+    namespace {
+        std::int64_t nanoseconds(const timespec &time) {
+            return static_cast<std::int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+        }
+
+        std::string parentOf(std::string_view path) {
+            auto parent = std::filesystem::path{path}.parent_path();
+            return parent.empty() ? std::string{"."} : parent.native();
+        }
+    }
+
+    PermissionCache::PermissionCache(std::size_t capacity, bool useInotify)
+            : mCapacity(capacity), mSlotMask(std::bit_ceil(std::max<std::size_t>(capacity, 1) * 2) - 1) {
+        mSlots = std::make_unique<std::atomic<Entry *>[]>(mSlotMask + 1);
+        mEntries.reserve(mCapacity);
+        if (useInotify) {
+            mWatcher = std::make_unique<InotifyWatcher>([this](const std::filesystem::path &directory,
+                                                               std::string_view name) {
+                invalidate(directory, name);
+            });
+            if (!*mWatcher)
+                mWatcher.reset();
+        }
+    }
+
+    PermissionCache::Entry *PermissionCache::find(std::string_view path, std::size_t hash) const {
+        for (auto idx = hash & mSlotMask; ; idx = (idx + 1) & mSlotMask) {
+            auto entry = mSlots[idx].load(std::memory_order_acquire);
+            if (entry == nullptr)
+                return nullptr;
+            if (entry->hash == hash && entry->path == path)
+                return entry;
+        }
+    }
+
+    bool PermissionCache::read(const Entry &entry, Snapshot &snapshot) {
+        auto sequence = entry.sequence.load(std::memory_order_acquire);
+        if (sequence & 1u)
+            return false;
+        snapshot.flags = entry.flags.load(std::memory_order_relaxed);
+        snapshot.perms = entry.perms.load(std::memory_order_relaxed);
+        snapshot.device = entry.device.load(std::memory_order_relaxed);
+        snapshot.inode = entry.inode.load(std::memory_order_relaxed);
+        snapshot.mtime = entry.mtime.load(std::memory_order_relaxed);
+        snapshot.ctime = entry.ctime.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return entry.sequence.load(std::memory_order_relaxed) == sequence;
+    }
+
+    void PermissionCache::write(Entry &entry, const Snapshot &snapshot) {
+        auto sequence = entry.sequence.load(std::memory_order_relaxed);
+        entry.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        entry.flags.store(snapshot.flags, std::memory_order_relaxed);
+        entry.perms.store(snapshot.perms, std::memory_order_relaxed);
+        entry.device.store(snapshot.device, std::memory_order_relaxed);
+        entry.inode.store(snapshot.inode, std::memory_order_relaxed);
+        entry.mtime.store(snapshot.mtime, std::memory_order_relaxed);
+        entry.ctime.store(snapshot.ctime, std::memory_order_relaxed);
+        entry.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    PermissionCache::Snapshot PermissionCache::evaluate(const std::string &path, std::uint32_t flags) {
+        Snapshot snapshot{flags | Valid};
+        struct stat statBuf{};
+        if (stat(path.c_str(), &statBuf) == 0) {
+            Permissions permissions{path, statBuf};
+            snapshot.flags |= Exists | (permissions.regular() ? Regular : 0u);
+            snapshot.perms = (permissions.read() ? Permissions::READ : 0u) |
+                             (permissions.write() ? Permissions::WRITE : 0u) |
+                             (permissions.exec() ? Permissions::EXEC : 0u);
+            snapshot.device = statBuf.st_dev;
+            snapshot.inode = statBuf.st_ino;
+            snapshot.mtime = nanoseconds(statBuf.st_mtim);
+            snapshot.ctime = nanoseconds(statBuf.st_ctim);
+        }
+        return snapshot;
+    }
+
+    PermissionCache::Status PermissionCache::status(const Snapshot &snapshot) {
+        return {(snapshot.flags & Exists) != 0, (snapshot.flags & Regular) != 0, snapshot.perms};
+    }
+
+    bool PermissionCache::unchanged(const std::string &path, const Snapshot &snapshot) {
+        struct stat statBuf{};
+        if (stat(path.c_str(), &statBuf) != 0)
+            return (snapshot.flags & Exists) == 0;
+        return (snapshot.flags & Exists) != 0 && snapshot.device == statBuf.st_dev &&
+               snapshot.inode == statBuf.st_ino && snapshot.mtime == nanoseconds(statBuf.st_mtim) &&
+               snapshot.ctime == nanoseconds(statBuf.st_ctim);
+    }
+
+    PermissionCache::Status PermissionCache::lookup(const std::filesystem::path &path) {
+        std::string_view key{path.native()};
+        auto hash = std::hash<std::string_view>{}(key);
+
+        if (auto entry = find(key, hash); entry) {
+            Snapshot snapshot{};
+            if (read(*entry, snapshot) && (snapshot.flags & Valid)) {
+                if ((snapshot.flags & Watched) || unchanged(entry->path, snapshot)) {
+                    mHits.fetch_add(1, std::memory_order_relaxed);
+                    return status(snapshot);
+                }
+                mInvalidations.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        mMisses.fetch_add(1, std::memory_order_relaxed);
+        return refresh(key, hash);
+    }
+
+    PermissionCache::Status PermissionCache::refresh(std::string_view path, std::size_t hash) {
+        std::lock_guard<std::mutex> lock{mWriteMutex};
+
+        auto entry = find(path, hash);
+        if (entry == nullptr) {
+            if (mEntries.size() >= mCapacity)
+                return status(evaluate(std::string{path}, 0));
+
+            entry = mEntries.emplace_back(std::make_unique<Entry>()).get();
+            entry->path = path;
+            entry->hash = hash;
+            mByDirectory[parentOf(path)].push_back(entry);
+
+            auto idx = hash & mSlotMask;
+            while (mSlots[idx].load(std::memory_order_relaxed) != nullptr)
+                idx = (idx + 1) & mSlotMask;
+            mSlots[idx].store(entry, std::memory_order_release);
+        }
+
+        // Watch before evaluating so a change after the evaluation is always seen as an event.
+        std::uint32_t flags = (mWatcher && mWatcher->watch(parentOf(path))) ? Watched : 0u;
+        auto snapshot = evaluate(entry->path, flags);
+        write(*entry, snapshot);
+        return status(snapshot);
+    }
+
+    void PermissionCache::invalidate(Entry &entry) {
+        entry.flags.fetch_and(~static_cast<std::uint32_t>(Valid), std::memory_order_release);
+    }
+
+    void PermissionCache::invalidate(const std::filesystem::path &directory, std::string_view name) {
+        std::lock_guard<std::mutex> lock{mWriteMutex};
+        if (directory.empty()) {
+            for (auto &entry : mEntries)
+                invalidate(*entry);
+            mInvalidations.fetch_add(mEntries.size(), std::memory_order_relaxed);
+            return;
+        }
+
+        if (auto entries = mByDirectory.find(directory.native()); entries != mByDirectory.end()) {
+            for (auto entry : entries->second) {
+                if (name.empty()) {
+                    // The directory itself changed and its watch may be gone, so fall back to validation.
+                    entry->flags.fetch_and(~static_cast<std::uint32_t>(Valid | Watched), std::memory_order_release);
+                    mInvalidations.fetch_add(1, std::memory_order_relaxed);
+                } else if (std::filesystem::path{entry->path}.filename().native() == name) {
+                    invalidate(*entry);
+                    mInvalidations.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+
+    void PermissionCache::invalidate(const std::filesystem::path &path) {
+        std::lock_guard<std::mutex> lock{mWriteMutex};
+        std::string_view key{path.native()};
+        if (auto entry = find(key, std::hash<std::string_view>{}(key)); entry) {
+            invalidate(*entry);
+            mInvalidations.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void PermissionCache::invalidateAll() {
+        invalidate(std::filesystem::path{}, std::string_view{});
+    }
+
+} // ysh
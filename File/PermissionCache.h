@@ -0,0 +1,188 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * PermissionCache.h Created by Richard Buckley (C) 19/10/26
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "InotifyWatcher.h"
+#include "Permissions.h"
+
+#ifndef YSH_PERMISSIONCACHE_H
+#define YSH_PERMISSIONCACHE_H
+
+namespace ysh {
+
+/**
+ * @class PermissionCache
+ * @brief A process wide cache of file existence, type and permissions keyed by path.
+ * @details Lookups do not lock. An entry is read under a sequence number and retried on the slow path if a
+ * writer was updating it. Entries are invalidated by inotify(7) events on the parent directory of the path.
+ * When the parent can not be watched, because inotify is unavailable or the directory does not exist, an
+ * entry is validated on each lookup by one stat(2) call comparing the device, inode, mtime and ctime.
+ *
+ * Only the parent directory is watched, so renaming or replacing a directory further up the path is not
+ * noticed until the entry is invalidated some other way.
+ */
+    class PermissionCache {
+    public:
+        /**
+         * @struct Status
+         * @brief The cached status of a file, with the accessors of Permissions.
+         */
+        struct Status {
+            bool fileExists{false};
+            bool isRegular{false};
+            unsigned int procPerms{0};
+
+            explicit operator bool() const { return fileExists; }
+
+            [[nodiscard]] bool regular() const { return fileExists && isRegular; }
+
+            [[nodiscard]] bool read() const { return fileExists && (procPerms & Permissions::READ) != 0; }
+
+            [[nodiscard]] bool write() const { return fileExists && (procPerms & Permissions::WRITE) != 0; }
+
+            [[nodiscard]] bool exec() const { return fileExists && (procPerms & Permissions::EXEC) != 0; }
+
+            [[nodiscard]] bool mask(unsigned int maskValue) const {
+                return fileExists && (procPerms & maskValue) == maskValue;
+            }
+        };
+
+        /**
+         * @struct Stats
+         * @brief Cache counters.
+         */
+        struct Stats {
+            std::uint64_t hits{0};              ///< Lookups answered from the cache.
+            std::uint64_t misses{0};            ///< Lookups that had to evaluate the file.
+            std::uint64_t invalidations{0};     ///< Entries invalidated by events or validation.
+        };
+
+        static constexpr std::size_t DefaultCapacity = 4096;
+
+    private:
+        enum Flags : std::uint32_t {
+            Exists = 1u << 0,
+            Regular = 1u << 1,
+            Valid = 1u << 2,
+            Watched = 1u << 3,
+        };
+
+        struct Entry {
+            std::string path{};
+            std::size_t hash{};
+            std::atomic<std::uint32_t> sequence{0};
+            std::atomic<std::uint32_t> flags{0};
+            std::atomic<std::uint32_t> perms{0};
+            std::atomic<std::uint64_t> device{0};
+            std::atomic<std::uint64_t> inode{0};
+            std::atomic<std::int64_t> mtime{0};
+            std::atomic<std::int64_t> ctime{0};
+        };
+
+        /**
+         * @struct Snapshot
+         * @brief A consistent copy of the fields of an Entry.
+         */
+        struct Snapshot {
+            std::uint32_t flags{0};
+            std::uint32_t perms{0};
+            std::uint64_t device{0};
+            std::uint64_t inode{0};
+            std::int64_t mtime{0};
+            std::int64_t ctime{0};
+        };
+
+        std::size_t mCapacity;
+        std::unique_ptr<std::atomic<Entry *>[]> mSlots;    ///< Open addressing table, twice the capacity.
+        std::size_t mSlotMask;
+
+        std::mutex mWriteMutex{};                           ///< Serializes inserts, refreshes and invalidation.
+        std::vector<std::unique_ptr<Entry>> mEntries{};
+        std::unordered_map<std::string, std::vector<Entry *>> mByDirectory{};
+
+        std::atomic<std::uint64_t> mHits{0};
+        std::atomic<std::uint64_t> mMisses{0};
+        std::atomic<std::uint64_t> mInvalidations{0};
+
+        std::unique_ptr<InotifyWatcher> mWatcher{};         ///< Last, so it stops before the table is destroyed.
+
+        Entry *find(std::string_view path, std::size_t hash) const;
+
+        static bool read(const Entry &entry, Snapshot &snapshot);
+
+        static void write(Entry &entry, const Snapshot &snapshot);
+
+        static Snapshot evaluate(const std::string &path, std::uint32_t flags);
+
+        static Status status(const Snapshot &snapshot);
+
+        static bool unchanged(const std::string &path, const Snapshot &snapshot);
+
+        Status refresh(std::string_view path, std::size_t hash);
+
+        void invalidate(const std::filesystem::path &directory, std::string_view name);
+
+        static void invalidate(Entry &entry);
+
+    public:
+        /**
+         * @brief Construct a cache.
+         * @param capacity The maximum number of paths cached. Lookups of further paths are not cached.
+         * @param useInotify Watch parent directories for changes, otherwise validate entries with stat(2).
+         */
+        explicit PermissionCache(std::size_t capacity = DefaultCapacity, bool useInotify = true);
+
+        PermissionCache(const PermissionCache &) = delete;
+        PermissionCache &operator=(const PermissionCache &) = delete;
+
+        ~PermissionCache() = default;
+
+        /**
+         * @brief The process wide cache.
+         */
+        static PermissionCache &instance() {
+            static PermissionCache cache{};
+            return cache;
+        }
+
+        /**
+         * @brief Get the status of a file.
+         * @param path The file path.
+         * @return The file status.
+         */
+        Status lookup(const std::filesystem::path &path);
+
+        /**
+         * @brief Invalidate the entry for a path.
+         */
+        [[maybe_unused]] void invalidate(const std::filesystem::path &path);
+
+        /**
+         * @brief Invalidate every entry.
+         */
+        [[maybe_unused]] void invalidateAll();
+
+        /**
+         * @brief Read the cache counters.
+         */
+        [[nodiscard]] Stats stats() const {
+            return {mHits.load(std::memory_order_relaxed), mMisses.load(std::memory_order_relaxed),
+                    mInvalidations.load(std::memory_order_relaxed)};
+        }
+    };
+
+} // ysh
+
+#endif //YSH_PERMISSIONCACHE_H
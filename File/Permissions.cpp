@@ -7,45 +7,113 @@
  */
 
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <algorithm>
+#include <cerrno>
 #include <iostream>
 #include "Permissions.h"
 
 namespace ysh {
 
     using namespace std::filesystem;
+
+    Credentials::Credentials() : mEuid(geteuid()), mEgid(getegid()) {
+        if (auto count = getgroups(0, nullptr); count > 0) {
+            mGroups.resize(static_cast<std::size_t>(count));
+            count = getgroups(count, mGroups.data());
+            mGroups.resize(static_cast<std::size_t>(std::max(count, 0)));
+            std::sort(mGroups.begin(), mGroups.end());
+        }
+    }
+
+    bool Credentials::member(gid_t gid) const {
+        return gid == mEgid || std::binary_search(mGroups.begin(), mGroups.end(), gid);
+    }
+
     void Permissions::evaluate() {
         fileExists = known = false;
         procPerms = 0;
-        auto euid = geteuid();
-        auto egid = getegid();
         if (!filePath.empty()) {
-            if (fileExists = exists(filePath); fileExists) {
-                fileStatus = status(filePath);
-                filePerms = fileStatus.permissions();
-                struct stat statBuf{};
-                if (stat(filePath.c_str(), &statBuf)) {
+            struct stat statBuf{};
+            if (stat(filePath.c_str(), &statBuf)) {
+                if (errno != ENOENT && errno != ENOTDIR)
                     std::cerr << "Can not stat " << filePath.string() << '\n';
-                } else {
-                    if (euid == statBuf.st_uid) {
-                        procPerms |= ((filePerms & perms::owner_read) != perms::none) ? READ : 0;
-                        procPerms |= ((filePerms & perms::owner_write) != perms::none) ? WRITE : 0;
-                        procPerms |= ((filePerms & perms::owner_exec) != perms::none) ? EXEC : 0;
-                    }
-
-                    if (egid == statBuf.st_gid) {
-                        procPerms |= ((filePerms & perms::group_read) != perms::none) ? READ : 0;
-                        procPerms |= ((filePerms & perms::group_write) != perms::none) ? WRITE : 0;
-                        procPerms |= ((filePerms & perms::group_exec) != perms::none) ? EXEC : 0;
-                    }
-
-                    procPerms |= ((filePerms & perms::others_read) != perms::none) ? READ : 0;
-                    procPerms |= ((filePerms & perms::others_write) != perms::none) ? WRITE : 0;
-                    procPerms |= ((filePerms & perms::others_exec) != perms::none) ? EXEC : 0;
-
-                    known = true;
-                }
+            } else {
+                evaluate(statBuf);
             }
         }
     }
+
+    void Permissions::evaluate(const struct stat &statBuf) {
+        const auto &credentials = Credentials::process();
+        procPerms = 0;
+        fileExists = known = true;
+        filePerms = static_cast<perms>(statBuf.st_mode) & perms::mask;
+
+        auto type = file_type::unknown;
+        if (S_ISREG(statBuf.st_mode))
+            type = file_type::regular;
+        else if (S_ISDIR(statBuf.st_mode))
+            type = file_type::directory;
+        else if (S_ISLNK(statBuf.st_mode))
+            type = file_type::symlink;
+        else if (S_ISBLK(statBuf.st_mode))
+            type = file_type::block;
+        else if (S_ISCHR(statBuf.st_mode))
+            type = file_type::character;
+        else if (S_ISFIFO(statBuf.st_mode))
+            type = file_type::fifo;
+        else if (S_ISSOCK(statBuf.st_mode))
+            type = file_type::socket;
+        fileStatus = file_status(type, filePerms);
+
+        if (credentials.euid() == statBuf.st_uid) {
+            procPerms |= ((filePerms & perms::owner_read) != perms::none) ? READ : 0;
+            procPerms |= ((filePerms & perms::owner_write) != perms::none) ? WRITE : 0;
+            procPerms |= ((filePerms & perms::owner_exec) != perms::none) ? EXEC : 0;
+        }
+
+        if (credentials.member(statBuf.st_gid)) {
+            procPerms |= ((filePerms & perms::group_read) != perms::none) ? READ : 0;
+            procPerms |= ((filePerms & perms::group_write) != perms::none) ? WRITE : 0;
+            procPerms |= ((filePerms & perms::group_exec) != perms::none) ? EXEC : 0;
+        }
+
+        procPerms |= ((filePerms & perms::others_read) != perms::none) ? READ : 0;
+        procPerms |= ((filePerms & perms::others_write) != perms::none) ? WRITE : 0;
+        procPerms |= ((filePerms & perms::others_exec) != perms::none) ? EXEC : 0;
+    }
+
+    std::vector<Permissions> Permissions::evaluateAll(std::span<const path> paths) {
+        std::vector<Permissions> result{};
+        result.reserve(paths.size());
+        for (const auto &file : paths)
+            result.emplace_back(file);
+        return result;
+    }
+
+    std::vector<Permissions> Permissions::evaluateAll(int dirFd, std::span<const path> relativePaths) {
+        std::vector<Permissions> result{};
+        result.reserve(relativePaths.size());
+        for (const auto &file : relativePaths) {
+            struct stat statBuf{};
+            if (fstatat(dirFd, file.c_str(), &statBuf, 0) == 0) {
+                result.emplace_back(file, statBuf);
+            } else {
+                result.emplace_back();
+                result.back().filePath = file;
+            }
+        }
+        return result;
+    }
+
+    std::vector<bool> Permissions::accessAll(int dirFd, std::span<const path> relativePaths, unsigned int maskValue) {
+        // READ, WRITE and EXEC have the values of R_OK, W_OK and X_OK.
+        std::vector<bool> result{};
+        result.reserve(relativePaths.size());
+        for (const auto &file : relativePaths)
+            result.push_back(faccessat(dirFd, file.c_str(), static_cast<int>(maskValue), AT_EACCESS) == 0);
+        return result;
+    }
 } // ysh
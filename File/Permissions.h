@@ -7,12 +7,46 @@
  */
 
 #include <filesystem>
+#include <span>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #ifndef YSH_PERMISSIONS_H
 #define YSH_PERMISSIONS_H
 
 namespace ysh {
 
+/**
+ * @class Credentials
+ * @brief The effective user, group and supplementary groups of the process.
+ * @details Read once, on first use, and cached for the life of the process. A process that changes its
+ * credentials after that will have its permissions evaluated against the original ones.
+ */
+    class Credentials {
+    private:
+        uid_t mEuid{};
+        gid_t mEgid{};
+        std::vector<gid_t> mGroups{};   ///< Supplementary groups, sorted.
+
+        Credentials();
+
+    public:
+        static const Credentials &process() {
+            static const Credentials credentials{};
+            return credentials;
+        }
+
+        [[nodiscard]] uid_t euid() const { return mEuid; }
+
+        [[nodiscard]] gid_t egid() const { return mEgid; }
+
+        /**
+         * @brief Test if the process is a member of a group, as effective or supplementary group.
+         */
+        [[nodiscard]] bool member(gid_t gid) const;
+    };
+
 /**
  * @class Permissions
  */
@@ -24,6 +58,8 @@ namespace ysh {
 
         void evaluate();
 
+        void evaluate(const struct stat &statBuf);
+
         bool fileExists{false}; ///< File exists
         bool known{false};      ///< File permissions are known
         unsigned int procPerms{0};  ///< The aggregated permissions the process holds on the file.
@@ -39,12 +75,58 @@ namespace ysh {
             evaluate();
         }
 
+        /**
+         * @brief Evaluate permissions from the result of a stat(2) call already made on the file.
+         * @param filePath The file path.
+         * @param statBuf The file status.
+         */
+        Permissions(std::filesystem::path filePath, const struct stat &statBuf) : filePath(std::move(filePath)) {
+            evaluate(statBuf);
+        }
+
+        /**
+         * @brief Evaluate the permissions on a list of files.
+         * @param paths The file paths.
+         * @return A Permissions object for each path, in the same order.
+         */
+        [[maybe_unused]] static std::vector<Permissions> evaluateAll(std::span<const std::filesystem::path> paths);
+
+        /**
+         * @brief Evaluate the permissions on a list of files relative to an open directory.
+         * @details Each file costs one fstatat(2) call, with no path resolution above the directory.
+         * @param dirFd The open directory file descriptor.
+         * @param relativePaths File paths relative to the directory.
+         * @return A Permissions object for each path, in the same order.
+         */
+        [[maybe_unused]] static std::vector<Permissions> evaluateAll(int dirFd,
+                                                                     std::span<const std::filesystem::path> relativePaths);
+
+        /**
+         * @brief Test a list of files relative to an open directory for permissions with faccessat(2).
+         * @details The kernel makes the decision with the effective credentials (AT_EACCESS), so unlike the
+         * mode bit evaluation it accounts for privileges and access control lists.
+         * @param dirFd The open directory file descriptor, or AT_FDCWD.
+         * @param relativePaths File paths relative to the directory.
+         * @param maskValue a bitwise OR of READ, WRITE, EXEC class constants.
+         * @return For each path, true if the process has all requested permissions.
+         */
+        [[maybe_unused]] static std::vector<bool> accessAll(int dirFd, std::span<const std::filesystem::path> relativePaths,
+                                                            unsigned int maskValue);
+
         /**
          * @brief Test validity of the Permission object.
          * @return True if the file exists and permissions are known.
          */
         explicit operator bool () const { return fileExists && known; }
 
+        /**
+         * @brief Test if the file is a regular file.
+         * @return true or false
+         */
+        [[maybe_unused]] [[nodiscard]] bool regular() const {
+            return fileExists && known && std::filesystem::is_regular_file(fileStatus);
+        }
+
         /**
          * @brief Test if the process has read permission on the file.
          * @return true or false
@@ -11,22 +11,34 @@
  * @author Richard Buckley <richard.buckley@ieee.org>
  * @version 1.0
  * @date 03/02/23
- * @brief 
+ * @brief
  * @details
  */
 
 #ifndef YSH_STRCOMPOSITE_H
 #define YSH_STRCOMPOSITE_H
 
+#include <array>
+#include <cassert>
+#include <charconv>
+#include <concepts>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <ostream>
+#include <span>
 #include <string>
+#include <string_view>
 #include <sstream>
+#include <type_traits>
 
 namespace ysh {
 
     /**
      * @struct StringAppend
      * @brief Derived from std::string adding the capability of appending simple deduced types.
-     * @details This is used with StringComposite to build up a string from a variadic argument pack.
+     * @details Retained for existing callers, StringComposite() no longer uses it.
      * Any argument that satisfies std::string::append(arg), std::string::append(1,char) or
      * std::to_string(arg) can be concatenated together to form a std::string.
      */
@@ -41,10 +53,254 @@ namespace ysh {
         void appendArg(Arg arg) { append(std::to_string(arg)); }
     };
 
+    namespace composite {
+
+        template<class Arg>
+        using Bare = std::remove_cvref_t<Arg>;
+
+        /**
+         * @brief Argument types the single pass compositor formats without going through std::string.
+         * @details All three narrow character types, so int8_t and uint8_t, are written as a character as
+         * std::ostream writes them, not as a number.
+         */
+        template<class Arg>
+        concept Character = std::is_same_v<Bare<Arg>, char> || std::is_same_v<Bare<Arg>, signed char>
+                            || std::is_same_v<Bare<Arg>, unsigned char>;
+
+        template<class Arg>
+        concept Boolean = std::is_same_v<Bare<Arg>, bool>;
+
+        template<class Arg>
+        concept Integer = std::is_integral_v<Bare<Arg>> && !Character<Arg> && !Boolean<Arg>;
+
+        template<class Arg>
+        concept Float = std::is_floating_point_v<Bare<Arg>>;
+
+        template<class Arg>
+        concept Text = std::is_convertible_v<const Bare<Arg>&, std::string_view> && !Character<Arg>;
+
+        template<class Arg>
+        concept Path = std::is_same_v<Bare<Arg>, std::filesystem::path>;
+
+        template<class Arg>
+        concept Direct = Character<Arg> || Boolean<Arg> || Integer<Arg> || Float<Arg> || Text<Arg> || Path<Arg>;
+
+        /**
+         * @brief Any other argument type that can be inserted into a std::ostream.
+         */
+        template<class Arg>
+        concept Streamable = !Direct<Arg> && requires(std::ostream &out, const Arg &arg) { out << arg; };
+
+        /**
+         * @brief View the characters of a text or path argument.
+         */
+        template<class Arg>
+        requires Text<Arg> || Path<Arg>
+        std::string_view textOf(const Arg &arg) {
+            if constexpr (Path<Arg>)
+                return std::string_view{arg.native()};
+            else
+                return std::string_view{arg};
+        }
+
+        /**
+         * @brief The number of decimal digits in a non-negative number.
+         */
+        constexpr std::size_t decimalDigits(long long value) {
+            std::size_t digits = 1;
+            for (; value >= 10; value /= 10)
+                ++digits;
+            return digits;
+        }
+
+        /**
+         * @brief The compile time upper bound on the formatted length of an argument type.
+         * @details Zero when the length can only be known from the value. String literals are bounded by
+         * their array extent.
+         */
+        template<class Arg>
+        constexpr std::size_t staticBound() {
+            using Type = Bare<Arg>;
+            if constexpr (Character<Arg> || Boolean<Arg>) {
+                return 1;
+            } else if constexpr (Integer<Arg>) {
+                // One for a digit digits10 does not count, one for the sign.
+                return static_cast<std::size_t>(std::numeric_limits<Type>::digits10) + 2;
+            } else if constexpr (Float<Arg>) {
+                // Shortest round trip form, never longer than scientific: sign, digits, point, 'e', exponent
+                // sign, exponent digits. Subnormal exponents reach below min_exponent10 by up to the digits.
+                using Limits = std::numeric_limits<Type>;
+                constexpr auto exponent = std::max<long long>(Limits::max_exponent10,
+                                                              Limits::max_digits10 - Limits::min_exponent10);
+                return static_cast<std::size_t>(Limits::max_digits10) + decimalDigits(exponent) + 4;
+            } else if constexpr (std::is_array_v<Type>) {
+                return std::extent_v<Type> > 0 ? std::extent_v<Type> - 1 : 0;
+            } else {
+                return 0;
+            }
+        }
+
+        /**
+         * @brief An upper bound on the formatted length of an argument.
+         */
+        template<class Arg>
+        requires Direct<Arg>
+        std::size_t bound(const Arg &arg) {
+            if constexpr (staticBound<Arg>() != 0) {
+                return staticBound<Arg>();
+            } else {
+                return textOf(arg).size();
+            }
+        }
+
+        /**
+         * @struct Written
+         * @brief The result of writing arguments.
+         */
+        struct Written {
+            char *end;          ///< One past the last character written.
+            bool complete;      ///< False if an argument did not fit, the output is truncated.
+        };
+
+        /**
+         * @brief Format an argument into [first, last).
+         * @details Text that does not fit is truncated at last. A character or number that does not fit is not
+         * written at all.
+         */
+        template<class Arg>
+        requires Direct<Arg>
+        Written write(char *first, char *last, const Arg &arg) {
+            if constexpr (Character<Arg> || Boolean<Arg>) {
+                if (first == last)
+                    return {first, false};
+                if constexpr (Boolean<Arg>)
+                    *first = arg ? '1' : '0';
+                else
+                    *first = static_cast<char>(arg);
+                return {first + 1, true};
+            } else if constexpr (Integer<Arg> || Float<Arg>) {
+                auto [ptr, ec] = std::to_chars(first, last, arg);
+                return ec == std::errc() ? Written{ptr, true} : Written{first, false};
+            } else {
+                auto text = textOf(arg);
+                auto available = static_cast<std::size_t>(last - first);
+                auto length = std::min(text.size(), available);
+                std::memcpy(first, text.data(), length);
+                return {first + length, length == text.size()};
+            }
+        }
+
+        /**
+         * @brief Render an argument to a form the compositor writes directly.
+         * @details Directly formatted arguments are passed through by reference, only Streamable arguments are
+         * rendered through a std::ostringstream.
+         */
+        template<class Arg>
+        requires Direct<Arg> || Streamable<Arg>
+        decltype(auto) stage(const Arg &arg) {
+            if constexpr (Direct<Arg>) {
+                return (arg);
+            } else {
+                std::ostringstream out{};
+                out << arg;
+                return std::move(out).str();
+            }
+        }
+
+        /**
+         * @brief Write a pack of arguments into [first, last), stopping after the first that does not fit.
+         */
+        template<typename... Args>
+        Written writeAll(char *first, char *last, const Args &... args) {
+            Written written{first, true};
+            ((written.complete ? void(written = write(written.end, last, args)) : void()), ...);
+            return written;
+        }
+
+        /**
+         * @brief Write a pack of arguments into space sized from bound().
+         * @details An argument longer than its bound is a defect in bound(), the program is aborted rather than
+         * the output truncated. Nothing is thrown, so this is usable where exceptions are disabled.
+         * @return One past the last character written.
+         */
+        template<typename... Args>
+        char *writeBounded(char *first, char *last, const Args &... args) {
+            auto written = writeAll(first, last, args...);
+            if (!written.complete) [[unlikely]] {
+                assert(!"ysh::composite argument exceeded its length bound.");
+                std::abort();
+            }
+            return written.end;
+        }
+
+        /**
+         * @brief Size a string once and write a pack of directly formatted arguments into it.
+         */
+        template<typename... Args>
+        requires (Direct<Args> && ...)
+        std::string join(const Args &... args) {
+            std::string out{};
+            out.resize((bound(args) + ... + 0));
+            auto end = writeBounded(out.data(), out.data() + out.size(), args...);
+            out.resize(static_cast<std::size_t>(end - out.data()));
+            return out;
+        }
+
+    } // composite
+
+    /**
+     * @class InlineString
+     * @brief A fixed capacity, null terminated string stored in place.
+     * @details Used as the result of StringCompositeInline() where no heap allocation may be done. Content
+     * that would exceed the capacity is truncated, and truncated() reports it.
+     * @tparam Capacity The maximum number of characters held, not counting the terminating null.
+     */
+    template<std::size_t Capacity>
+    class InlineString {
+    private:
+        std::array<char, Capacity + 1> mData{};
+        std::size_t mSize{0};
+        bool mTruncated{false};
+
+    public:
+        InlineString() = default;
+
+        /**
+         * @brief Replace the content with the composite of an argument pack.
+         * @return A view of the new content.
+         */
+        template<typename... Args>
+        std::string_view assign(const Args &... args) {
+            auto written = composite::writeAll(mData.data(), mData.data() + Capacity, args...);
+            mSize = static_cast<std::size_t>(written.end - mData.data());
+            mTruncated = !written.complete;
+            mData[mSize] = '\0';
+            return view();
+        }
+
+        [[nodiscard]] std::string_view view() const { return {mData.data(), mSize}; }
+
+        [[nodiscard]] const char *c_str() const { return mData.data(); }
+
+        [[nodiscard]] std::size_t size() const { return mSize; }
+
+        /**
+         * @brief True if the last assign() did not fit.
+         */
+        [[nodiscard]] bool truncated() const { return mTruncated; }
+
+        [[nodiscard]] static constexpr std::size_t capacity() { return Capacity; }
+
+        operator std::string_view() const { return view(); }  // NOLINT(google-explicit-constructor)
+    };
+
     /**
      * @brief Composite a pack of arguments that are streamable to a string.
-     * @details Uses StringAppend to build up the final string. This may be lighter weight than
-     * StringStreamComposite() but has less utility.
+     * @details This is the one compositing engine, dispatching at compile time on each argument type. The
+     * length of the result is bounded from the argument types, at compile time for characters, numbers and
+     * string literals, the result is allocated once, and numbers are written in place with std::to_chars.
+     * Floating point values use the shortest round trip form and paths are written unquoted. Only argument
+     * types without a direct form are rendered through a std::ostringstream.
      * @tparam Arg First argument type
      * @tparam Args Rest of the argument types
      * @param arg First argument
@@ -53,15 +309,54 @@ namespace ysh {
      */
     template<typename Arg, typename... Args>
     [[maybe_unused]] std::string StringComposite(Arg &&arg, Args &&... args) {
-        StringAppend out{};
-        out.appendArg(std::forward<Arg>(arg));
-        (out.appendArg(std::forward<Args>(args)), ...);
+        return composite::join(composite::stage(arg), composite::stage(args)...);
+    }
+
+    /**
+     * @struct Composited
+     * @brief The result of StringCompositeTo().
+     */
+    struct Composited {
+        std::string_view view;  ///< The characters written to the buffer.
+        bool complete;          ///< False if the output was truncated.
+    };
+
+    /**
+     * @brief Composite a pack of arguments into a caller supplied buffer.
+     * @details No allocation is done. Writing stops at the first argument that does not fit: text is written
+     * up to the end of the buffer, a character or number is left out. Arguments after it are not written.
+     * The result is not null terminated.
+     * @param buffer The buffer to write into.
+     * @param args The arguments.
+     * @return A view of the characters written to the buffer, and whether every argument was written whole.
+     */
+    template<typename... Args>
+    requires (composite::Direct<Args> && ...)
+    [[maybe_unused]] Composited StringCompositeTo(std::span<char> buffer, const Args &... args) {
+        auto written = composite::writeAll(buffer.data(), buffer.data() + buffer.size(), args...);
+        return {{buffer.data(), static_cast<std::size_t>(written.end - buffer.data())}, written.complete};
+    }
+
+    /**
+     * @brief Composite a pack of arguments into an InlineString.
+     * @tparam Capacity The capacity of the returned InlineString.
+     * @param args The arguments.
+     * @return The InlineString.
+     */
+    template<std::size_t Capacity, typename... Args>
+    requires (composite::Direct<Args> && ...)
+    [[maybe_unused]] InlineString<Capacity> StringCompositeInline(const Args &... args) {
+        InlineString<Capacity> out{};
+        out.assign(args...);
         return out;
     }
 
     /**
      * @brief Composite a pack of arguments that are streamable to a string.
-     * @details Uses std::stringstream to build up the final string.
+     * @details Retained for existing callers, this is StringComposite(). The std::ostream compositor it replaced
+     * wrote the same text for characters, including signed and unsigned char, integers, booleans and strings. It
+     * differs for paths, which are no longer quoted, and floating point values, which are written in shortest
+     * round trip form rather than to six significant digits.
      * @tparam Arg First argument type
      * @tparam Args Rest of the argument types
      * @param arg First argument
@@ -70,10 +365,7 @@ namespace ysh {
      */
     template<typename Arg, typename... Args>
     [[maybe_unused]] std::string StringStreamComposite(Arg &&arg, Args &&... args) {
-        std::stringstream out{};
-        out << std::forward<Arg>(arg);
-        ((out << std::forward<Args>(args)), ...);
-        return out.str();
+        return StringComposite(std::forward<Arg>(arg), std::forward<Args>(args)...);
     }
 
 } // ysh
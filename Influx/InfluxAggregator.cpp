@@ -0,0 +1,135 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * InfluxAggregator.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include "InfluxAggregator.h"
+
+InfluxAggregator::InfluxAggregator(std::chrono::nanoseconds window, std::size_t expectedSeries)
+        : mWindow(static_cast<unsigned long long>(std::max(window.count(), std::chrono::nanoseconds::rep{1}))) {
+    mAggregates.reserve(expectedSeries);
+    mIndex.resize(std::bit_ceil(std::max(expectedSeries * 2, std::size_t{16})), EmptySlot);
+}
+
+std::uint64_t InfluxAggregator::hash(std::string_view prefix, std::string_view name) {
+    // FNV-1a over the prefix, a separator that can not appear in either, and the name.
+    std::uint64_t h = 14695981039346656037ULL;
+    auto mix = [&h](char c) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 1099511628211ULL;
+    };
+    for (auto c : prefix)
+        mix(c);
+    mix('\n');
+    for (auto c : name)
+        mix(c);
+    return h;
+}
+
+InfluxAggregator::Aggregate &InfluxAggregator::find(std::string_view prefix, std::string_view name) {
+    auto h = hash(prefix, name);
+    auto mask = mIndex.size() - 1;
+    for (auto slot = static_cast<std::size_t>(h) & mask; ; slot = (slot + 1) & mask) {
+        auto entry = mIndex[slot];
+        if (entry == EmptySlot)
+            break;
+        auto &aggregate = mAggregates[entry - 1];
+        if (aggregate.hash == h && prefixOf(aggregate) == prefix && nameOf(aggregate) == name)
+            return aggregate;
+    }
+
+    if (prefix.size() > std::numeric_limits<std::uint16_t>::max()
+        || name.size() > std::numeric_limits<std::uint16_t>::max()
+        || mKeys.size() + prefix.size() + name.size() > std::numeric_limits<std::uint32_t>::max())
+        throw std::length_error("InfluxAggregator series key too long.");
+
+    if ((mAggregates.size() + 1) * 2 > mIndex.size())
+        grow();
+
+    Aggregate aggregate{};
+    aggregate.hash = h;
+    aggregate.keyOffset = static_cast<std::uint32_t>(mKeys.size());
+    aggregate.prefixLength = static_cast<std::uint16_t>(prefix.size());
+    aggregate.nameLength = static_cast<std::uint16_t>(name.size());
+    mKeys.append(prefix).append(name);
+    mAggregates.push_back(aggregate);
+
+    mask = mIndex.size() - 1;
+    auto slot = static_cast<std::size_t>(h) & mask;
+    while (mIndex[slot] != EmptySlot)
+        slot = (slot + 1) & mask;
+    mIndex[slot] = static_cast<std::uint32_t>(mAggregates.size());
+    return mAggregates.back();
+}
+
+void InfluxAggregator::grow() {
+    std::vector<std::uint32_t> index(mIndex.size() * 2, EmptySlot);
+    auto mask = index.size() - 1;
+    for (std::size_t entry = 0; entry < mAggregates.size(); ++entry) {
+        auto slot = static_cast<std::size_t>(mAggregates[entry].hash) & mask;
+        while (index[slot] != EmptySlot)
+            slot = (slot + 1) & mask;
+        index[slot] = static_cast<std::uint32_t>(entry + 1);
+    }
+    mIndex.swap(index);
+}
+
+void InfluxAggregator::close(Aggregate &aggregate) {
+    if (aggregate.count == 0)
+        return;
+    auto name = nameOf(aggregate);
+    mClosed.append(prefixOf(aggregate),
+                   name, "_min=", aggregate.min, ',',
+                   name, "_max=", aggregate.max, ',',
+                   name, "_mean=", aggregate.sum / static_cast<double>(aggregate.count), ',',
+                   name, "_count=", aggregate.count, 'i', ' ', aggregate.windowStart, '\n');
+    aggregate.count = 0;
+    // An empty aggregate's window start is the earliest time a sample is not late.
+    aggregate.windowStart += mWindow;
+}
+
+void InfluxAggregator::add(std::string_view prefix, std::string_view name, double value, unsigned long long timeStamp) {
+    if (!std::isfinite(value)) {
+        ++mNonFinite;
+        return;
+    }
+    auto &aggregate = find(prefix, name);
+    auto windowStart = timeStamp - timeStamp % mWindow;
+    if (windowStart < aggregate.windowStart) {
+        ++mLate;
+        return;
+    }
+    if (aggregate.count == 0 || windowStart != aggregate.windowStart) {
+        close(aggregate);
+        aggregate.windowStart = windowStart;
+        aggregate.count = 1;
+        aggregate.min = aggregate.max = aggregate.sum = value;
+        return;
+    }
+    ++aggregate.count;
+    aggregate.min = std::min(aggregate.min, value);
+    aggregate.max = std::max(aggregate.max, value);
+    aggregate.sum += value;
+}
+
+std::size_t InfluxAggregator::flush(InfluxLineBuffer &out, unsigned long long now) {
+    for (auto &aggregate : mAggregates)
+        if (aggregate.count && aggregate.windowStart + mWindow <= now)
+            close(aggregate);
+    auto size = mClosed.size();
+    out.append(mClosed.view());
+    mClosed.clear();
+    return size;
+}
+
+std::size_t InfluxAggregator::flushAll(InfluxLineBuffer &out) {
+    return flush(out, std::numeric_limits<unsigned long long>::max());
+}
@@ -0,0 +1,126 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * InfluxAggregator.h Created by Richard Buckley (C) 19/10/26
+ */
+
+#ifndef ECOBEEDATA_INFLUXAGGREGATOR_H
+#define ECOBEEDATA_INFLUXAGGREGATOR_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "InfluxLineBuffer.h"
+
+/**
+ * @class InfluxAggregator
+ * @brief Roll up high rate samples into one min, max, mean and count point per series per window.
+ * @details Series are keyed by measurement prefix and value name. Aggregates are stored contiguously and
+ * found through an open addressing index of 32 bit entry numbers with linear probing, key bytes are held
+ * in one shared string. Windows are aligned to multiples of the window length from epoch.
+ *
+ * When a sample arrives in a later window than its series' open window, the open window is closed. A late
+ * sample, one from before its series' open window or from a window already closed, is dropped and counted
+ * by lateSamples(), as its window's point has been written and InfluxDB would replace it. A NaN or infinite
+ * sample, which would make the window's line invalid, is dropped and counted by nonFiniteSamples(). Closed
+ * windows are written as line protocol to an internal buffer and handed over by flush(). Each closed window
+ * becomes one line time stamped with the start of the window:
+ * @code
+ * prefix name_min=1.5,name_max=9.25,name_mean=4.125,name_count=1000i windowStart
+ * @endcode
+ */
+class InfluxAggregator {
+private:
+    static constexpr std::uint32_t EmptySlot = 0;
+
+    struct Aggregate {
+        std::uint64_t hash{};
+        std::uint32_t keyOffset{};
+        std::uint16_t prefixLength{};
+        std::uint16_t nameLength{};
+        unsigned long long windowStart{};
+        std::uint64_t count{};
+        double min{};
+        double max{};
+        double sum{};
+    };
+
+    unsigned long long mWindow;
+    std::vector<Aggregate> mAggregates{};
+    std::vector<std::uint32_t> mIndex{};       ///< Aggregate number + 1, or EmptySlot.
+    std::string mKeys{};
+    InfluxLineBuffer mClosed{};
+    std::uint64_t mLate{0};
+    std::uint64_t mNonFinite{0};
+
+    static std::uint64_t hash(std::string_view prefix, std::string_view name);
+
+    [[nodiscard]] std::string_view prefixOf(const Aggregate &aggregate) const {
+        return std::string_view{mKeys}.substr(aggregate.keyOffset, aggregate.prefixLength);
+    }
+
+    [[nodiscard]] std::string_view nameOf(const Aggregate &aggregate) const {
+        return std::string_view{mKeys}.substr(aggregate.keyOffset + aggregate.prefixLength, aggregate.nameLength);
+    }
+
+    Aggregate &find(std::string_view prefix, std::string_view name);
+
+    void grow();
+
+    void close(Aggregate &aggregate);
+
+public:
+    /**
+     * @param window The window length.
+     * @param expectedSeries The number of series to size the table for.
+     */
+    explicit InfluxAggregator(std::chrono::nanoseconds window = std::chrono::seconds{1}, std::size_t expectedSeries = 64);
+
+    /**
+     * @brief Add a sample, unless it is late or not finite.
+     * @param prefix The measurement prefix, the measurement name, tags and the separating space.
+     * @param name The measurement value name.
+     * @param value The sample value.
+     * @param timeStamp The sample time stamp in nanoseconds from epoch.
+     */
+    void add(std::string_view prefix, std::string_view name, double value, unsigned long long timeStamp);
+
+    /**
+     * @brief Close every window that ends at or before a time, and move all closed windows to a line buffer.
+     * @param out The buffer the closed windows are appended to.
+     * @param now The current time stamp in nanoseconds from epoch.
+     * @return The number of bytes appended.
+     */
+    std::size_t flush(InfluxLineBuffer &out, unsigned long long now);
+
+    /**
+     * @brief Close every open window, and move all closed windows to a line buffer.
+     */
+    std::size_t flushAll(InfluxLineBuffer &out);
+
+    [[nodiscard]] std::size_t seriesCount() const { return mAggregates.size(); }
+
+    /**
+     * @brief The number of samples dropped because their window was already closed or superseded.
+     */
+    [[nodiscard]] std::uint64_t lateSamples() const { return mLate; }
+
+    /**
+     * @brief The number of samples dropped because they were NaN or infinite.
+     */
+    [[nodiscard]] std::uint64_t nonFiniteSamples() const { return mNonFinite; }
+
+    /**
+     * @brief The heap memory held by the aggregator, excluding the closed window buffer.
+     */
+    [[nodiscard]] std::size_t memoryUsage() const {
+        return mAggregates.capacity() * sizeof(Aggregate) + mIndex.capacity() * sizeof(std::uint32_t)
+               + mKeys.capacity();
+    }
+};
+
+#endif //ECOBEEDATA_INFLUXAGGREGATOR_H
@@ -0,0 +1,167 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * InfluxCluster.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include "InfluxCluster.h"
+
+InfluxCluster::InfluxCluster(const std::vector<InfluxEndpoint> &endpoints, Mode mode, Options options)
+        : mMode(mode), mOptions(options) {
+    if (endpoints.empty())
+        throw std::invalid_argument("InfluxCluster requires at least one endpoint.");
+
+    for (const auto &endpoint : endpoints) {
+        auto &added = mEndpoints.emplace_back(std::make_unique<Endpoint>(endpoint));
+        added->push.setTimeout(mOptions.timeout);
+    }
+    for (auto &endpoint : mEndpoints)
+        endpoint->sender = std::thread{&InfluxCluster::send, this, std::ref(*endpoint)};
+}
+
+InfluxCluster::~InfluxCluster() {
+    for (auto &endpoint : mEndpoints) {
+        {
+            std::lock_guard<std::mutex> lock{endpoint->mutex};
+            endpoint->stop = true;
+        }
+        endpoint->signal.notify_all();
+    }
+    for (auto &endpoint : mEndpoints)
+        if (endpoint->sender.joinable())
+            endpoint->sender.join();
+}
+
+std::size_t InfluxCluster::endpointFor(std::string_view prefix, std::string_view name) const {
+    if (mMode == Mode::Replicate || mEndpoints.size() == 1)
+        return 0;
+
+    // FNV-1a of the series key, so a series always lands on the same endpoint.
+    std::uint64_t h = 14695981039346656037ULL;
+    for (auto part : {prefix, name})
+        for (auto c : part) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 1099511628211ULL;
+        }
+    return static_cast<std::size_t>(h % mEndpoints.size());
+}
+
+InfluxLineBuffer &InfluxCluster::stageFor(std::string_view prefix, std::string_view name) {
+    return mEndpoints[endpointFor(prefix, name)]->staged;
+}
+
+void InfluxCluster::flush() {
+    auto enqueue = [this](Endpoint &endpoint, std::string_view lines) {
+        {
+            std::lock_guard<std::mutex> lock{endpoint.mutex};
+            auto batch = ysh::acquireBuffer();
+            batch->assign(lines);
+            endpoint.queue.push_back(std::move(batch));
+            while (endpoint.queue.size() > mOptions.queueLimit) {
+                endpoint.queue.pop_front();
+                ++endpoint.health.batchesDropped;
+            }
+        }
+        endpoint.signal.notify_all();
+    };
+
+    if (mMode == Mode::Replicate) {
+        auto &staged = mEndpoints.front()->staged;
+        if (staged.empty())
+            return;
+        for (auto &endpoint : mEndpoints)
+            enqueue(*endpoint, staged.view());
+        staged.clear();
+    } else {
+        for (auto &endpoint : mEndpoints) {
+            if (endpoint->staged.empty())
+                continue;
+            enqueue(*endpoint, endpoint->staged.view());
+            endpoint->staged.clear();
+        }
+    }
+}
+
+void InfluxCluster::send(Endpoint &endpoint) {
+    std::unique_lock<std::mutex> lock{endpoint.mutex};
+    while (!endpoint.stop) {
+        if (endpoint.queue.empty()) {
+            endpoint.signal.wait(lock);
+            continue;
+        }
+
+        if (endpoint.health.breaker == Breaker::Open) {
+            if (std::chrono::steady_clock::now() < endpoint.openUntil) {
+                endpoint.signal.wait_until(lock, endpoint.openUntil);
+                continue;
+            }
+            endpoint.health.breaker = Breaker::HalfOpen;
+        } else if (std::chrono::steady_clock::now() < endpoint.retryAt) {
+            endpoint.signal.wait_until(lock, endpoint.retryAt);
+            continue;
+        }
+
+        auto batch = std::move(endpoint.queue.front());
+        endpoint.queue.pop_front();
+        endpoint.sending = true;
+        lock.unlock();
+
+        auto start = std::chrono::steady_clock::now();
+        auto result = endpoint.push.push(*batch);
+        auto finish = std::chrono::steady_clock::now();
+
+        lock.lock();
+        endpoint.sending = false;
+        endpoint.health.lastLatency = finish - start;
+        if (result == InfluxPush::PushResult::Accepted) {
+            ++endpoint.health.batchesSent;
+            endpoint.health.consecutiveFailures = 0;
+            endpoint.health.breaker = Breaker::Closed;
+        } else if (result == InfluxPush::PushResult::Rejected) {
+            // The node answered, the data is at fault. Sending it again would fail the same way.
+            ++endpoint.health.batchesRejected;
+        } else {
+            ++endpoint.health.batchesFailed;
+            ++endpoint.health.consecutiveFailures;
+            if (endpoint.health.breaker == Breaker::HalfOpen
+                || endpoint.health.consecutiveFailures >= mOptions.failureThreshold) {
+                endpoint.health.breaker = Breaker::Open;
+                endpoint.openUntil = finish + mOptions.openDuration;
+            } else {
+                auto doublings = std::min(endpoint.health.consecutiveFailures - 1, 16u);
+                endpoint.retryAt = finish + std::min<std::chrono::milliseconds>(
+                        mOptions.retryDelay * (1L << doublings), mOptions.openDuration);
+            }
+            // Retry ahead of newer batches, unless that would exceed the limit.
+            if (endpoint.queue.size() < mOptions.queueLimit)
+                endpoint.queue.push_front(std::move(batch));
+            else
+                ++endpoint.health.batchesDropped;
+        }
+        endpoint.signal.notify_all();
+    }
+}
+
+bool InfluxCluster::drain(std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    bool idle = true;
+    for (auto &endpoint : mEndpoints) {
+        std::unique_lock<std::mutex> lock{endpoint->mutex};
+        idle &= endpoint->signal.wait_until(lock, deadline, [&endpoint] {
+            return (endpoint->queue.empty() && !endpoint->sending) || endpoint->health.breaker == Breaker::Open;
+        });
+    }
+    return idle;
+}
+
+InfluxCluster::Health InfluxCluster::health(std::size_t endpoint) const {
+    auto &selected = *mEndpoints.at(endpoint);
+    std::lock_guard<std::mutex> lock{selected.mutex};
+    auto health = selected.health;
+    health.batchesQueued = selected.queue.size();
+    return health;
+}
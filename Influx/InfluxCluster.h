@@ -0,0 +1,178 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * InfluxCluster.h Created by Richard Buckley (C) 19/10/26
+ */
+
+#ifndef ECOBEEDATA_INFLUXCLUSTER_H
+#define ECOBEEDATA_INFLUXCLUSTER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <ObjectPool.h>
+#include "InfluxPush.h"
+
+/**
+ * @struct InfluxEndpoint
+ * @brief One InfluxDB node, the InfluxPush constructor parameters.
+ */
+struct InfluxEndpoint {
+    std::string host{};
+    bool tls{false};
+    long port{8086};
+    std::string dataBase{};
+};
+
+/**
+ * @class InfluxCluster
+ * @brief Write measurements to several InfluxDB nodes, sharded by series or replicated to all.
+ * @details Measurements are staged per endpoint. flush() hands each endpoint's batch to that endpoint's
+ * sender thread and returns without waiting, so a slow or failed node only delays its own batches. Each
+ * endpoint has a circuit breaker: after FailureThreshold consecutive failures it opens and batches are held
+ * without being sent until OpenDuration has passed, then one batch is tried. Batches that fail are retried
+ * ahead of newer ones, after RetryDelay doubled for each consecutive failure. A batch InfluxDB refuses with
+ * a 4xx reply is released and counted, it does not count as a failure of the endpoint. An endpoint holds at most
+ * QueueLimit batches, the oldest are dropped beyond that. Batches are not rerouted to other endpoints.
+ *
+ * Staging is not thread safe: addMeasurement() and flush() must be called from one thread at a time.
+ * drain() and health() may be called from any thread.
+ */
+class InfluxCluster {
+public:
+    enum class Mode {
+        Shard,          ///< Each series is written to one endpoint chosen by a hash of its key.
+        Replicate,      ///< Every series is written to every endpoint.
+    };
+
+    struct Options {
+        std::chrono::milliseconds timeout{std::chrono::seconds{5}};    ///< Per push time limit.
+        unsigned failureThreshold{3};                                   ///< Failures that open the breaker.
+        std::chrono::milliseconds openDuration{std::chrono::seconds{10}};
+        std::size_t queueLimit{64};                                     ///< Batches held per endpoint.
+        std::chrono::milliseconds retryDelay{100};                      ///< Wait before the first retry.
+    };
+
+    enum class Breaker {
+        Closed,         ///< Sending normally.
+        Open,           ///< Not sending until the open duration has passed.
+        HalfOpen,       ///< Sending one trial batch.
+    };
+
+    /**
+     * @struct Health
+     * @brief The state of one endpoint.
+     */
+    struct Health {
+        Breaker breaker{Breaker::Closed};
+        unsigned consecutiveFailures{0};
+        std::uint64_t batchesSent{0};
+        std::uint64_t batchesFailed{0};
+        std::uint64_t batchesDropped{0};
+        std::uint64_t batchesRejected{0};   ///< Refused by InfluxDB with a 4xx reply and released.
+        std::size_t batchesQueued{0};
+        std::chrono::nanoseconds lastLatency{0};
+    };
+
+private:
+    struct Endpoint {
+        InfluxPush push;
+        InfluxLineBuffer staged{};
+
+        std::mutex mutex{};
+        std::condition_variable signal{};
+        std::deque<ysh::PooledBuffer> queue{};
+        Health health{};
+        std::chrono::steady_clock::time_point openUntil{};
+        std::chrono::steady_clock::time_point retryAt{};
+        bool sending{false};
+        bool stop{false};
+        std::thread sender{};
+
+        explicit Endpoint(const InfluxEndpoint &endpoint) :
+                push(endpoint.host, endpoint.tls, endpoint.port, endpoint.dataBase) {}
+    };
+
+    Mode mMode;
+    Options mOptions;
+    cURLpp::Cleanup mCleanup{};
+    std::vector<std::unique_ptr<Endpoint>> mEndpoints{};
+
+    void send(Endpoint &endpoint);
+
+    InfluxLineBuffer &stageFor(std::string_view prefix, std::string_view name);
+
+public:
+    InfluxCluster() = delete;
+
+    InfluxCluster(const std::vector<InfluxEndpoint> &endpoints, Mode mode, Options options);
+
+    InfluxCluster(const std::vector<InfluxEndpoint> &endpoints, Mode mode)
+            : InfluxCluster(endpoints, mode, Options{}) {}
+
+    InfluxCluster(const InfluxCluster &) = delete;
+    InfluxCluster &operator=(const InfluxCluster &) = delete;
+
+    /**
+     * @brief Stop the sender threads. Batches still queued are abandoned, call drain() first to keep them.
+     */
+    ~InfluxCluster();
+
+    /**
+     * @brief Stage a measurement, see InfluxPush::addMeasurement(). Not thread safe.
+     */
+    bool addMeasurement(std::string_view prefix, std::string_view name, std::string_view value,
+                        unsigned long long timeStamp) {
+        if (name.empty() || value.empty())
+            return false;
+        stageFor(prefix, name).add(prefix, name, value, timeStamp);
+        return true;
+    }
+
+    /**
+     * @brief Stage a numeric measurement, see InfluxPush::addMeasurement(). Not thread safe.
+     */
+    template<InfluxNumeric Value>
+    bool addMeasurement(std::string_view prefix, std::string_view name, Value value, unsigned long long timeStamp) {
+        if (name.empty())
+            return false;
+        return stageFor(prefix, name).add(prefix, name, value, timeStamp);
+    }
+
+    /**
+     * @brief Queue the staged measurements for sending. Does not wait for the sends.
+     * @details Not thread safe, it must not run concurrently with itself or addMeasurement().
+     */
+    void flush();
+
+    /**
+     * @brief Wait until every endpoint has sent, or is holding behind an open breaker, all queued batches.
+     * @param timeout The longest time to wait.
+     * @return true if all endpoints are idle.
+     */
+    bool drain(std::chrono::milliseconds timeout);
+
+    [[nodiscard]] std::size_t size() const { return mEndpoints.size(); }
+
+    /**
+     * @brief The endpoint a series is sharded to, in the order the endpoints were given.
+     * @details In Mode::Replicate the series is written to every endpoint and this returns 0.
+     */
+    [[nodiscard]] std::size_t endpointFor(std::string_view prefix, std::string_view name) const;
+
+    /**
+     * @brief The state of an endpoint, in the order the endpoints were given.
+     */
+    [[nodiscard]] Health health(std::size_t endpoint) const;
+};
+
+#endif //ECOBEEDATA_INFLUXCLUSTER_H
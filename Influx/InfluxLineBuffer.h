@@ -0,0 +1,112 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * InfluxLineBuffer.h Created by Richard Buckley (C) 19/10/26
+ */
+
+#ifndef ECOBEEDATA_INFLUXLINEBUFFER_H
+#define ECOBEEDATA_INFLUXLINEBUFFER_H
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <StringComposite.h>
+
+/**
+ * @brief A type written as a numeric InfluxDB field: arithmetic, other than bool and the character types.
+ */
+template<typename Value>
+concept InfluxNumeric = std::is_arithmetic_v<Value> && !std::is_same_v<Value, bool>
+                        && !std::is_same_v<Value, char> && !std::is_same_v<Value, signed char>
+                        && !std::is_same_v<Value, unsigned char> && !std::is_same_v<Value, wchar_t>
+                        && !std::is_same_v<Value, char8_t> && !std::is_same_v<Value, char16_t>
+                        && !std::is_same_v<Value, char32_t>;
+
+/**
+ * @brief Test if line protocol can hold a numeric field value.
+ * @return false for NaN and infinities, and for unsigned values above the largest signed 64 bit integer field.
+ */
+template<InfluxNumeric Value>
+bool influxRepresentable(Value value) {
+    if constexpr (std::is_floating_point_v<Value>)
+        return std::isfinite(value);
+    else if constexpr (std::is_unsigned_v<Value>)
+        return value <= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+    else
+        return true;
+}
+
+/**
+ * @class InfluxLineBuffer
+ * @brief An InfluxDB line protocol measurement store.
+ * @details Lines are composited directly onto the end of one std::string. clear() keeps the capacity, so a
+ * store that is filled and pushed in a loop stops allocating once it has grown to the size of one batch.
+ *
+ * https://archive.docs.influxdata.com/influxdb/v1.2/write_protocols/line_protocol_reference/
+ */
+class InfluxLineBuffer {
+private:
+    std::string mLines{};
+
+public:
+    /**
+     * @brief Append the composite of an argument pack, see ysh::StringComposite().
+     */
+    template<typename... Args>
+    requires (ysh::composite::Direct<Args> && ...)
+    void append(const Args &... args) {
+        auto size = mLines.size();
+        mLines.resize(size + (ysh::composite::bound(args) + ... + 0));
+        auto end = ysh::composite::writeBounded(mLines.data() + size, mLines.data() + mLines.size(), args...);
+        mLines.resize(static_cast<std::size_t>(end - mLines.data()));
+    }
+
+    /**
+     * @brief Add one measurement line: prefix name=value timeStamp
+     * @param prefix The measurement prefix, the measurement name, tags and the separating space.
+     * @param name The measurement value name.
+     * @param value The measurement value, already formatted.
+     * @param timeStamp The time stamp in nanoseconds from epoch.
+     */
+    void add(std::string_view prefix, std::string_view name, std::string_view value, unsigned long long timeStamp) {
+        append(prefix, name, '=', value, ' ', timeStamp, '\n');
+    }
+
+    /**
+     * @brief Add one measurement line with a numeric value.
+     * @details Integer values are written as InfluxDB integer fields with the 'i' suffix, floating point
+     * values in their shortest round trip form. A value influxRepresentable() refuses is not written, as
+     * InfluxDB would reject the whole batch holding it.
+     * @return true if the line was added.
+     */
+    template<InfluxNumeric Value>
+    bool add(std::string_view prefix, std::string_view name, Value value, unsigned long long timeStamp) {
+        if (!influxRepresentable(value))
+            return false;
+        if constexpr (std::is_integral_v<Value>)
+            append(prefix, name, '=', value, 'i', ' ', timeStamp, '\n');
+        else
+            append(prefix, name, '=', value, ' ', timeStamp, '\n');
+        return true;
+    }
+
+    /**
+     * @brief Remove all lines, retaining the storage.
+     */
+    void clear() { mLines.clear(); }
+
+    [[nodiscard]] bool empty() const { return mLines.empty(); }
+
+    [[nodiscard]] std::size_t size() const { return mLines.size(); }
+
+    [[nodiscard]] std::string_view view() const { return mLines; }
+
+    [[nodiscard]] const std::string &str() const { return mLines; }
+};
+
+#endif //ECOBEEDATA_INFLUXLINEBUFFER_H
@@ -0,0 +1,72 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * InfluxMetrics.h Created by Richard Buckley (C) 19/10/26
+ */
+
+#ifndef ECOBEEDATA_INFLUXMETRICS_H
+#define ECOBEEDATA_INFLUXMETRICS_H
+
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <Metrics.h>
+#include "InfluxLineBuffer.h"
+#include "InfluxSeries.h"
+
+/**
+ * @brief An unsigned metric value as an InfluxDB integer field, which is signed 64 bit.
+ * @return The value, clamped to the largest integer field value.
+ */
+constexpr std::int64_t influxInteger(std::uint64_t value) {
+    constexpr auto Largest = std::numeric_limits<std::int64_t>::max();
+    return value > static_cast<std::uint64_t>(Largest) ? Largest : static_cast<std::int64_t>(value);
+}
+
+/**
+ * @brief Write a metrics snapshot as line protocol.
+ * @details One line per metric, the metric name is the value of the 'metric' tag:
+ * @code
+ * measurement,metric=name count=12i ts
+ * measurement,metric=name value=-3i ts
+ * measurement,metric=name count=40i,sum=81920i,mean=2048,p50=2047i,p90=3071i,p99=4095i,max=4100i ts
+ * @endcode
+ * The measurement and metric names are escaped as line protocol requires. Counter and histogram values
+ * above the largest integer field value are clamped to it.
+ * @param buffer The line buffer to append to.
+ * @param measurement The measurement name.
+ * @param snapshot The snapshot.
+ * @param timeStamp The time stamp in nanoseconds from epoch.
+ */
+inline void writeMetrics(InfluxLineBuffer &buffer, std::string_view measurement, const ysh::MetricsSnapshot &snapshot,
+                         unsigned long long timeStamp) {
+    std::string series{};
+    InfluxSeriesRegistry::appendMeasurement(series, measurement);
+    series.append(",metric=");
+    auto prefixLength = series.size();
+    auto seriesOf = [&series, prefixLength](std::string_view name) -> std::string_view {
+        series.resize(prefixLength);
+        InfluxSeriesRegistry::appendKey(series, name);
+        return series;
+    };
+
+    for (const auto &[name, value] : snapshot.counters)
+        buffer.append(seriesOf(name), " count=", influxInteger(value), 'i', ' ', timeStamp, '\n');
+
+    for (const auto &[name, value] : snapshot.gauges)
+        buffer.append(seriesOf(name), " value=", value, 'i', ' ', timeStamp, '\n');
+
+    for (const auto &[name, histogram] : snapshot.histograms) {
+        if (histogram.count == 0)
+            continue;
+        buffer.append(seriesOf(name), " count=", influxInteger(histogram.count),
+                      "i,sum=", influxInteger(histogram.sum), "i,mean=", histogram.mean(),
+                      ",p50=", influxInteger(histogram.quantile(0.5)), "i,p90=", influxInteger(histogram.quantile(0.9)),
+                      "i,p99=", influxInteger(histogram.quantile(0.99)), "i,max=", influxInteger(histogram.max),
+                      'i', ' ', timeStamp, '\n');
+    }
+}
+
+#endif //ECOBEEDATA_INFLUXMETRICS_H
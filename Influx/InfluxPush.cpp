@@ -9,15 +9,18 @@
 #include <ctime>
 #include <cstring>
 #include <iostream>
+#include <curlpp/Infos.hpp>
 #include "InfluxPush.h"
 
-bool InfluxPush::pushData() {
+InfluxPush::PushResult InfluxPush::push(const std::string &postData) const {
+    static auto &pushLatency = ysh::MetricsRegistry::instance().histogram("influx.push_ns");
+    static auto &pushFailures = ysh::MetricsRegistry::instance().counter("influx.push_failures");
+    ysh::ScopedTimer timer{pushLatency};
+
     std::stringstream buildUrl{};
     
     buildUrl << (connectTls ? "https" : "http")
              << "://" << influxHost << ':' << influxPort << "/write?db=" << influxDataBase;
-    
-    auto postData = measurements.str();
 
     if (!postData.empty())
         try {
@@ -31,16 +34,32 @@ bool InfluxPush::pushData() {
             request.setOpt(new cURLpp::Options::HttpHeader(header));
             request.setOpt(new cURLpp::Options::PostFieldSize(static_cast<long>(postData.length())));
             request.setOpt(new cURLpp::Options::PostFields(postData));
+            request.setOpt(new cURLpp::Options::WriteFunction([](char *, size_t size, size_t count) {
+                return size * count;    // Discard the response body.
+            }));
+            if (pushTimeout.count() > 0) {
+                request.setOpt(new cURLpp::Options::NoSignal(true));
+                request.setOpt(new cURLpp::Options::TimeoutMs(static_cast<long>(pushTimeout.count())));
+            }
 
             request.perform();
+            if (auto code = cURLpp::Infos::ResponseCode::get(request); code < 200 || code >= 300) {
+                std::cerr << "InfluxDB push to " << influxHost << ':' << influxPort << " returned " << code << '\n';
+                pushFailures.add();
+                if (code >= 400 && code < 500 && code != 408 && code != 429)
+                    return PushResult::Rejected;
+                return PushResult::Failed;
+            }
         } catch (cURLpp::LogicError &e) {
             std::cerr << e.what() << '\n';
-            return false;
+            pushFailures.add();
+            return PushResult::Failed;
         } catch (cURLpp::RuntimeError &e) {
             std::cerr << e.what() << '\n';
-            return false;
+            pushFailures.add();
+            return PushResult::Failed;
         }
-    return true;
+    return PushResult::Accepted;
 }
 
 void InfluxPush::setMeasurementEpoch(const std::string &date, const std::string &time) {
@@ -62,6 +81,5 @@ void InfluxPush::setMeasurementEpoch(const std::string &date, const std::string
 }
 
 void InfluxPush::showData() {
-    auto postData = measurements.str();
-    std::cout << '\n' << postData << "\n" << std::endl;
+    std::cout << '\n' << measurements.view() << "\n" << std::endl;
 }
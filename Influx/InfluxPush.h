@@ -10,6 +10,7 @@
 #define ECOBEEDATA_INFLUXPUSH_H
 
 
+#include <chrono>
 #include <string>
 #include <utility>
 #include <cmath>
@@ -19,6 +20,10 @@
 #include <curlpp/Easy.hpp>
 #include <curlpp/Options.hpp>
 #include <curlpp/Exception.hpp>
+#include "InfluxAggregator.h"
+#include "InfluxLineBuffer.h"
+#include "InfluxMetrics.h"
+#include "InfluxSeries.h"
 
 /**
  * @class InfluxPush
@@ -35,8 +40,9 @@ private:
     bool connectTls{false};
     long influxPort{0};
     std::string influxDataBase{};
+    std::chrono::milliseconds pushTimeout{0};
 
-    std::stringstream measurements{};
+    InfluxLineBuffer measurements{};
 
 public:
     InfluxPush() = delete;
@@ -60,7 +66,7 @@ public:
      * @brief Clear the measurements store.
      */
     void newMeasurements() {
-        measurements.str("");
+        measurements.clear();
     }
 
     /**
@@ -90,23 +96,107 @@ public:
     bool addMeasurement(const std::string& prefix, const std::optional<std::string>& name,
                         const std::optional<std::string>& value, unsigned long long useTimeStamp) {
         if (name.has_value() && !name.value().empty() && value.has_value() && !value.value().empty()) {
-            measurements << prefix << name.value() << '=' << value.value() << ' ' << useTimeStamp << '\n';
+            measurements.add(prefix, name.value(), value.value(), useTimeStamp);
             return true;
         }
         return false;
     }
 
+    /**
+     * @brief Add a numeric measurement to the measurement store without formatting it to a string first.
+     * @param prefix The measurement prefix.
+     * @param name The measurement value name.
+     * @param value The measurement value, integers are stored as InfluxDB integer fields.
+     * @param useTimeStamp The time stamp in nanoseconds from epoch.
+     * @return false if the name is empty or the value can not be written, see influxRepresentable().
+     */
+    template<InfluxNumeric Value>
+    bool addMeasurement(std::string_view prefix, std::string_view name, Value value, unsigned long long useTimeStamp) {
+        if (name.empty())
+            return false;
+        return measurements.add(prefix, name, value, useTimeStamp);
+    }
+
+    /**
+     * @brief Add a numeric measurement of an interned series, see InfluxSeriesRegistry.
+     * @param series The registry the series was interned in.
+     * @param id The series identifier.
+     * @param value The measurement value, integers are stored as InfluxDB integer fields.
+     * @param useTimeStamp The time stamp in nanoseconds from epoch.
+     * @return false if the value can not be written, see influxRepresentable().
+     */
+    template<InfluxNumeric Value>
+    bool addMeasurement(const InfluxSeriesRegistry &series, InfluxSeriesId id, Value value,
+                        unsigned long long useTimeStamp) {
+        return series.write(measurements, id, value, useTimeStamp);
+    }
+
+    /**
+     * @brief Move the windows an aggregator has closed by a time into the measurement store.
+     * @param aggregator The aggregator.
+     * @param now The current time stamp in nanoseconds from epoch.
+     */
+    void addAggregates(InfluxAggregator &aggregator, unsigned long long now) {
+        aggregator.flush(measurements, now);
+    }
+
+    /**
+     * @brief Add a metrics snapshot to the measurement store, see writeMetrics().
+     * @param snapshot The snapshot, usually from ysh::MetricsRegistry::snapshot().
+     * @param measurement The measurement name.
+     * @param useTimeStamp The time stamp in nanoseconds from epoch.
+     */
+    void addMetrics(const ysh::MetricsSnapshot &snapshot, std::string_view measurement,
+                    unsigned long long useTimeStamp) {
+        writeMetrics(measurements, measurement, snapshot, useTimeStamp);
+    }
+
+    /**
+     * @brief Limit the time a push may take, connection included. Zero, the default, is no limit.
+     */
+    [[maybe_unused]] void setTimeout(std::chrono::milliseconds timeout) { pushTimeout = timeout; }
+
     /**
      * @brief Push the measurement store to the InfluxDB.
      * @return true if successful.
      */
-    bool pushData();
+    bool pushData() { return pushData(measurements.str()); }
+
+    /**
+     * @brief Push line protocol data, other than the measurement store, to the InfluxDB.
+     * @param postData The line protocol data.
+     * @return true if the data was empty or the server accepted it.
+     */
+    bool pushData(const std::string &postData) const { return push(postData) == PushResult::Accepted; }
+
+    /**
+     * @enum PushResult
+     * @brief The outcome of a push.
+     */
+    enum class PushResult {
+        Accepted,   ///< The data was empty or the server accepted it.
+        Rejected,   ///< The server refused the data itself with a 4xx reply, sending it again will not help.
+        Failed,     ///< No reply, a 5xx reply, 408 or 429, the push may be retried.
+    };
+
+    /**
+     * @brief Push line protocol data to the InfluxDB and tell a rejection apart from a failure.
+     * @param postData The line protocol data.
+     */
+    PushResult push(const std::string &postData) const;
 
     [[maybe_unused]] void showData();
 
     [[maybe_unused]] auto getMeasurements() const {
         return measurements.str();
     }
+
+    /**
+     * @brief A view of the measurement store without copying it.
+     */
+    [[maybe_unused]] [[nodiscard]] std::string_view viewMeasurements() const {
+        return measurements.view();
+    }
 };
 
 
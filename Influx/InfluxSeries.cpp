@@ -0,0 +1,99 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * InfluxSeries.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+#include <limits>
+#include <stdexcept>
+#include "InfluxSeries.h"
+
+namespace {
+    /**
+     * @brief Append text escaping the characters line protocol requires escaped in that position.
+     */
+    void appendEscaped(std::string &out, std::string_view text, std::string_view special) {
+        for (auto c : text) {
+            if (special.find(c) != std::string_view::npos)
+                out.push_back('\\');
+            out.push_back(c);
+        }
+    }
+}
+
+void InfluxSeriesRegistry::appendMeasurement(std::string &out, std::string_view measurement) {
+    appendEscaped(out, measurement, ", ");
+}
+
+void InfluxSeriesRegistry::appendKey(std::string &out, std::string_view key) {
+    appendEscaped(out, key, ",= ");
+}
+
+InfluxSeriesId InfluxSeriesRegistry::intern(std::string_view measurement, std::span<const Tag> tags,
+                                            std::string_view field) {
+    mScratch.clear();
+    appendMeasurement(mScratch, measurement);
+    for (const auto &[tagKey, tagValue] : tags) {
+        mScratch.push_back(',');
+        appendKey(mScratch, tagKey);
+        mScratch.push_back('=');
+        appendKey(mScratch, tagValue);
+    }
+    mScratch.push_back(' ');
+    appendKey(mScratch, field);
+    mScratch.push_back('=');
+    return internScratch();
+}
+
+InfluxSeriesId InfluxSeriesRegistry::intern(std::string_view prefix, std::string_view name) {
+    mScratch.assign(prefix).append(name).push_back('=');
+    return internScratch();
+}
+
+InfluxSeriesId InfluxSeriesRegistry::internScratch() {
+    // FNV-1a of the escaped key.
+    std::uint32_t hash = 2166136261u;
+    for (auto c : mScratch) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+
+    if (mIndex.empty())
+        mIndex.resize(64, EmptySlot);
+    auto mask = mIndex.size() - 1;
+    auto slot = static_cast<std::size_t>(hash) & mask;
+    for (; mIndex[slot] != EmptySlot; slot = (slot + 1) & mask) {
+        auto id = mIndex[slot] - 1;
+        if (mKeys[id].hash == hash && key(id) == mScratch)
+            return id;
+    }
+
+    if (mKeyBytes.size() + mScratch.size() > std::numeric_limits<std::uint32_t>::max()
+        || mKeys.size() == std::numeric_limits<InfluxSeriesId>::max() - 1)
+        throw std::length_error("InfluxSeriesRegistry is full.");
+
+    auto id = static_cast<InfluxSeriesId>(mKeys.size());
+    mKeys.push_back(Key{static_cast<std::uint32_t>(mKeyBytes.size()), static_cast<std::uint32_t>(mScratch.size()), hash});
+    mKeyBytes.append(mScratch);
+
+    if (mKeys.size() * 2 > mIndex.size()) {
+        grow();
+    } else {
+        mIndex[slot] = id + 1;
+    }
+    return id;
+}
+
+void InfluxSeriesRegistry::grow() {
+    std::vector<std::uint32_t> index(mIndex.size() * 2, EmptySlot);
+    auto mask = index.size() - 1;
+    for (InfluxSeriesId id = 0; id < mKeys.size(); ++id) {
+        auto slot = static_cast<std::size_t>(mKeys[id].hash) & mask;
+        while (index[slot] != EmptySlot)
+            slot = (slot + 1) & mask;
+        index[slot] = id + 1;
+    }
+    mIndex.swap(index);
+}
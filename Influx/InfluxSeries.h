@@ -0,0 +1,124 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * InfluxSeries.h Created by Richard Buckley (C) 19/10/26
+ */
+
+#ifndef ECOBEEDATA_INFLUXSERIES_H
+#define ECOBEEDATA_INFLUXSERIES_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "InfluxLineBuffer.h"
+
+/**
+ * @brief A compact identifier for an interned series.
+ */
+using InfluxSeriesId = std::uint32_t;
+
+/**
+ * @class InfluxSeriesRegistry
+ * @brief Intern series keys once so each point is encoded as a copy of the key followed by the value.
+ * @details A series is a measurement, its tags and one field. The escaped key, everything up to and
+ * including the '=' before the value, is stored once in a shared string and identified by an
+ * InfluxSeriesId. Interning the same series again returns the same identifier. The registry is not thread
+ * safe, and views returned by key() are invalidated by intern().
+ */
+class InfluxSeriesRegistry {
+private:
+    static constexpr std::uint32_t EmptySlot = 0;
+
+    struct Key {
+        std::uint32_t offset{};
+        std::uint32_t length{};
+        std::uint32_t hash{};
+    };
+
+    std::string mKeyBytes{};
+    std::vector<Key> mKeys{};
+    std::vector<std::uint32_t> mIndex{};       ///< Open addressing index of identifier + 1, or EmptySlot.
+    std::string mScratch{};
+
+    InfluxSeriesId internScratch();
+
+    void grow();
+
+public:
+    using Tag = std::pair<std::string_view, std::string_view>;
+
+    InfluxSeriesRegistry() = default;
+
+    InfluxSeriesRegistry(const InfluxSeriesRegistry &) = delete;
+    InfluxSeriesRegistry &operator=(const InfluxSeriesRegistry &) = delete;
+
+    /**
+     * @brief Append a measurement name, escaping commas and spaces.
+     */
+    static void appendMeasurement(std::string &out, std::string_view measurement);
+
+    /**
+     * @brief Append a tag key, tag value or field name, escaping commas, equals signs and spaces.
+     */
+    static void appendKey(std::string &out, std::string_view key);
+
+    /**
+     * @brief Intern a series, escaping the measurement, tags and field as line protocol requires.
+     * @param measurement The measurement name.
+     * @param tags The tag keys and values, in the order they are to be written.
+     * @param field The field name.
+     * @return The series identifier.
+     */
+    InfluxSeriesId intern(std::string_view measurement, std::span<const Tag> tags, std::string_view field);
+
+    /**
+     * @brief Intern a series in the form taken by InfluxPush::addMeasurement(), the prefix is not escaped.
+     * @param prefix The measurement prefix, the measurement name, tags and the separating space.
+     * @param name The field name.
+     * @return The series identifier.
+     */
+    InfluxSeriesId intern(std::string_view prefix, std::string_view name);
+
+    /**
+     * @brief The escaped key of a series, ending with '='.
+     */
+    [[nodiscard]] std::string_view key(InfluxSeriesId id) const {
+        const auto &key = mKeys[id];
+        return std::string_view{mKeyBytes}.substr(key.offset, key.length);
+    }
+
+    /**
+     * @brief Write one point of a series.
+     * @details Integer values are written as InfluxDB integer fields with the 'i' suffix. A value
+     * influxRepresentable() refuses is not written.
+     * @return true if the point was written.
+     */
+    template<InfluxNumeric Value>
+    bool write(InfluxLineBuffer &buffer, InfluxSeriesId id, Value value, unsigned long long timeStamp) const {
+        if (!influxRepresentable(value))
+            return false;
+        if constexpr (std::is_integral_v<Value>)
+            buffer.append(key(id), value, 'i', ' ', timeStamp, '\n');
+        else
+            buffer.append(key(id), value, ' ', timeStamp, '\n');
+        return true;
+    }
+
+    [[nodiscard]] std::size_t size() const { return mKeys.size(); }
+
+    /**
+     * @brief The heap memory held by the registry.
+     */
+    [[nodiscard]] std::size_t memoryUsage() const {
+        return mKeyBytes.capacity() + mKeys.capacity() * sizeof(Key) + mIndex.capacity() * sizeof(std::uint32_t)
+               + mScratch.capacity();
+    }
+};
+
+#endif //ECOBEEDATA_INFLUXSERIES_H
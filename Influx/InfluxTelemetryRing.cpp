@@ -0,0 +1,163 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * InfluxTelemetryRing.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <bit>
+#include <cerrno>
+#include <new>
+#include "InfluxTelemetryRing.h"
+#include "../XDG/XDGFilePaths.h"
+
+void InfluxTelemetryRing::create(const std::filesystem::path &path, std::uint32_t slotCount) {
+    // Build the ring under a private name and link it into place, so no process maps a half made ring.
+    auto temporary = path;
+    temporary += ysh::StringComposite(".", getpid());
+    ysh::FileDescriptor fd{::open(temporary.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600)};
+    if (!fd)
+        return;
+    auto size = fileSize(slotCount);
+    if (ftruncate(fd.get(), static_cast<off_t>(size)) == 0) {
+        if (auto mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+                mapping != MAP_FAILED) {
+            auto header = new(mapping) Header{};
+            header->slotCount = slotCount;
+            auto slots = reinterpret_cast<Slot *>(static_cast<char *>(mapping) + sizeof(Header));
+            for (std::uint32_t idx = 0; idx < slotCount; ++idx)
+                new(&slots[idx]) Slot{tag(idx, Free)};
+            munmap(mapping, size);
+            // Fails with EEXIST if another process won the race, its ring is used instead.
+            link(temporary.c_str(), path.c_str());
+        }
+    }
+    unlink(temporary.c_str());
+}
+
+InfluxTelemetryRing::InfluxTelemetryRing(const std::filesystem::path &path, std::uint32_t slotCount) {
+    mFd.reset(::open(path.c_str(), O_RDWR | O_CLOEXEC));
+    if (!mFd && errno == ENOENT) {
+        create(path, std::bit_ceil(std::max(slotCount, std::uint32_t{2})));
+        mFd.reset(::open(path.c_str(), O_RDWR | O_CLOEXEC));
+    }
+    struct stat statBuf{};
+    if (!mFd || fstat(mFd.get(), &statBuf) != 0 || static_cast<std::size_t>(statBuf.st_size) < sizeof(Header))
+        return;
+
+    auto size = static_cast<std::size_t>(statBuf.st_size);
+    auto mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, mFd.get(), 0);
+    if (mapping == MAP_FAILED)
+        return;
+    auto header = static_cast<Header *>(mapping);
+    if (header->magic != Magic || header->version != Version || !std::has_single_bit(header->slotCount)
+        || size != fileSize(header->slotCount)) {
+        munmap(mapping, size);
+        return;
+    }
+
+    mMapping = mapping;
+    mMappingSize = size;
+    mHeader = header;
+    mSlots = reinterpret_cast<Slot *>(static_cast<char *>(mapping) + sizeof(Header));
+    mMask = header->slotCount - 1;
+}
+
+InfluxTelemetryRing::~InfluxTelemetryRing() {
+    if (mMapping)
+        munmap(mMapping, mMappingSize);
+}
+
+std::optional<std::filesystem::path> InfluxTelemetryRing::defaultPath() {
+    xdg::XDGFilePaths filePaths{};
+    const auto &runtimeDirs = filePaths.paths(xdg::XDGFilePaths::XDG_RUNTIME_DIR);
+    if (runtimeDirs.empty())
+        return std::nullopt;
+    return runtimeDirs.front() / DefaultName;
+}
+
+InfluxTelemetryRing &InfluxTelemetryRing::instance() {
+    // Never destroyed, tools may write from threads that outlive static destruction.
+    static auto *ring = [] {
+        auto path = defaultPath();
+        return path ? new InfluxTelemetryRing{*path} : new InfluxTelemetryRing{};
+    }();
+    return *ring;
+}
+
+bool InfluxTelemetryRing::attachReader() {
+    if (!mHeader || flock(mFd.get(), LOCK_EX | LOCK_NB) != 0)
+        return false;
+    mReader = true;
+    mCursor = mHeader->readIndex.load(std::memory_order_acquire);
+    mStalledAt = ~std::uint64_t{0};
+    return true;
+}
+
+std::size_t InfluxTelemetryRing::read(InfluxLineBuffer &out, std::size_t maxLines, std::chrono::nanoseconds holeTimeout) {
+    if (!mReader)
+        return 0;
+    auto written = mHeader->writeIndex.load(std::memory_order_acquire);
+    std::size_t consumed = 0;
+    while (mCursor < written && consumed < maxLines) {
+        auto &slot = mSlots[mCursor & mMask];
+        auto state = slot.state.load(std::memory_order_acquire);
+        if (state == tag(mCursor, Ready)) {
+            if (auto length = slot.length; length > 0 && length <= LineCapacity)
+                out.append(std::string_view{slot.data, length});
+        } else if (state == tag(mCursor, Free) || state == tag(mCursor, Writing)) {
+            // Claimed but not published: wait for the writer, up to the hole timeout.
+            auto now = std::chrono::steady_clock::now();
+            if (mStalledAt != mCursor) {
+                mStalledAt = mCursor;
+                mStallStart = now;
+                break;
+            }
+            if (now - mStallStart < holeTimeout)
+                break;
+            if (!slot.state.compare_exchange_strong(state, tag(mCursor, Abandoned), std::memory_order_acquire,
+                                                    std::memory_order_acquire))
+                continue;   // Published at the last moment, read it.
+            mHeader->abandoned.fetch_add(1, std::memory_order_relaxed);
+        } else if (position(state) < mCursor) {
+            // Still held by the writer of an earlier lap, this position is lost.
+            if (!slot.state.compare_exchange_strong(state, tag(mCursor, Skipped), std::memory_order_acquire,
+                                                    std::memory_order_acquire))
+                continue;
+        }
+        // Otherwise the position was abandoned or skipped already, by a reader that stopped before it committed.
+        ++mCursor;
+        ++consumed;
+    }
+    return consumed;
+}
+
+void InfluxTelemetryRing::commit() {
+    if (!mReader)
+        return;
+    auto slotCount = mMask + 1;
+    for (auto released = mHeader->readIndex.load(std::memory_order_relaxed); released < mCursor; ++released) {
+        // Only published slots are released here, an abandoned or skipped slot is released by the writer
+        // holding it.
+        auto ready = tag(released, Ready);
+        mSlots[released & mMask].state.compare_exchange_strong(ready, tag(released + slotCount, Free),
+                                                               std::memory_order_release, std::memory_order_relaxed);
+    }
+    mHeader->readIndex.store(mCursor, std::memory_order_release);
+}
+
+TelemetryRingStats InfluxTelemetryRing::stats() const {
+    if (!mHeader)
+        return {};
+    // The read position first, so committed never exceeds written.
+    auto committed = mHeader->readIndex.load(std::memory_order_acquire);
+    return TelemetryRingStats{mHeader->writeIndex.load(std::memory_order_acquire), committed,
+                              mHeader->dropped.load(std::memory_order_relaxed),
+                              mHeader->abandoned.load(std::memory_order_relaxed)};
+}
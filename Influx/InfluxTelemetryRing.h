@@ -0,0 +1,305 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * InfluxTelemetryRing.h Created by Richard Buckley (C) 19/10/26
+ */
+
+#ifndef ECOBEEDATA_INFLUXTELEMETRYRING_H
+#define ECOBEEDATA_INFLUXTELEMETRYRING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <FileDescriptor.h>
+#include <StringComposite.h>
+#include "InfluxLineBuffer.h"
+
+/**
+ * @struct TelemetryRingStats
+ * @brief Counts kept in the header of an InfluxTelemetryRing, shared by every process that maps it.
+ */
+struct TelemetryRingStats {
+    std::uint64_t written{0};       ///< Slots claimed by writers.
+    std::uint64_t committed{0};     ///< Slots the reader has delivered and released.
+    std::uint64_t dropped{0};       ///< Points not written: the ring was full, the line too long or not valid.
+    std::uint64_t abandoned{0};     ///< Slots claimed by a writer that never published them.
+};
+
+/**
+ * @class InfluxTelemetryRing
+ * @brief A shared memory ring of line protocol points, written by any process and drained by one daemon.
+ * @details The ring is a file, by default in XDG_RUNTIME_DIR, mapped by every process that uses it. A header
+ * holds the write and read positions followed by fixed size slots, one line each. A writer claims a
+ * position with a bounded number of compare and swap attempts, marks the slot, composites the line
+ * directly into it and publishes it. No step waits for another process, so a tool is never slowed by the
+ * daemon. When the ring is full, or the claim keeps losing races, the point is dropped and counted.
+ *
+ * The reader, held by one process at a time with flock(2), copies published lines out with read() and
+ * releases their slots with commit() once they are delivered. The read position lives in the file, so a
+ * daemon that is restarted continues where the last one committed, and lines it read but never committed
+ * are delivered again. Writers hold only their own mapping and keep working while no daemon runs, until
+ * the ring fills.
+ *
+ * A slot claimed by a writer that dies before publishing it is skipped once it has been pending for the
+ * hole timeout given to read(), and marked abandoned. commit() does not release an abandoned slot, only its
+ * writer may. A writer that was merely stopped for that long finds the mark when it tries to publish, drops
+ * its point and then releases the slot, so no other writer can write into it meanwhile. Writers of later laps
+ * that land on the slot before it is released drop their points. The slot of a writer that died stays out of
+ * use.
+ *
+ * Lines must be single line protocol lines, and numeric values finite and within the signed 64 bit integer
+ * field. write() and add() drop anything else, as a line InfluxDB refuses would cost the daemon a whole batch.
+ */
+class InfluxTelemetryRing {
+public:
+    static constexpr std::string_view DefaultName{"ve3ysh-telemetry.ring"};
+    static constexpr std::uint32_t DefaultSlots = 4096;
+    static constexpr std::size_t SlotSize = 256;
+    static constexpr std::size_t CacheLine = 64;
+
+private:
+    static constexpr std::uint64_t Magic = 0x314d4c4554485359;  ///< "YSHTELM1" in little endian order.
+    static constexpr std::uint32_t Version = 2;
+    static constexpr unsigned ClaimAttempts = 16;
+
+    /**
+     * @brief The slot state word is the position the slot holds, shifted left three bits, and one of these.
+     * @details An Abandoned slot belongs to the writer of its position until that writer releases it. A slot
+     * still held by the writer of an earlier lap is marked Skipped for each later position that lands on it,
+     * by that position's writer or by the reader, whichever comes first, and released by the holder.
+     */
+    enum SlotState : std::uint64_t {
+        Free = 0,       ///< Waiting for the writer of the position.
+        Writing = 1,    ///< The writer is filling the slot.
+        Ready = 2,      ///< Published, waiting for the reader.
+        Abandoned = 3,  ///< Given up on by the reader, the writer may not publish it and releases it.
+        Skipped = 4,    ///< The position was lost, the slot is still held by the writer of an earlier lap.
+    };
+
+    struct Header {
+        std::uint64_t magic{Magic};
+        std::uint32_t version{Version};
+        std::uint32_t slotCount{0};
+        alignas(CacheLine) std::atomic<std::uint64_t> writeIndex{0};
+        alignas(CacheLine) std::atomic<std::uint64_t> readIndex{0};
+        alignas(CacheLine) std::atomic<std::uint64_t> dropped{0};
+        std::atomic<std::uint64_t> abandoned{0};
+    };
+
+    struct Slot {
+        std::atomic<std::uint64_t> state{0};
+        std::uint32_t length{0};
+        std::uint32_t reserved{0};
+        char data[SlotSize - 16]{};
+    };
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "Ring atomics must work across processes.");
+    static_assert(std::is_standard_layout_v<Header> && sizeof(Header) % CacheLine == 0);
+    static_assert(std::is_standard_layout_v<Slot> && sizeof(Slot) == SlotSize);
+
+public:
+    static constexpr std::size_t LineCapacity = sizeof(Slot::data);   ///< Longest line, newline included.
+
+private:
+    ysh::FileDescriptor mFd{};
+    void *mMapping{nullptr};
+    std::size_t mMappingSize{0};
+    Header *mHeader{nullptr};
+    Slot *mSlots{nullptr};
+    std::uint64_t mMask{0};
+
+    // Reader state, only used by the process holding the reader lock.
+    bool mReader{false};
+    std::uint64_t mCursor{0};
+    std::uint64_t mStalledAt{~std::uint64_t{0}};
+    std::chrono::steady_clock::time_point mStallStart{};
+
+    static constexpr std::uint64_t tag(std::uint64_t position, SlotState state) { return position << 3 | state; }
+
+    static constexpr std::uint64_t position(std::uint64_t state) { return state >> 3; }
+
+    /**
+     * @brief Release a slot this writer holds but may not publish, to the lap after the last position marked.
+     */
+    void release(Slot &slot, std::uint64_t state) noexcept {
+        while (!slot.state.compare_exchange_weak(state, tag(position(state) + mMask + 1, Free),
+                                                 std::memory_order_release, std::memory_order_relaxed)) {}
+    }
+
+    /**
+     * @brief Count a point dropped.
+     */
+    bool drop() noexcept {
+        if (mHeader)
+            mHeader->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /**
+     * @brief Create and initialize a ring file, atomically, unless one already exists.
+     */
+    static void create(const std::filesystem::path &path, std::uint32_t slotCount);
+
+    static std::size_t fileSize(std::uint32_t slotCount) { return sizeof(Header) + slotCount * sizeof(Slot); }
+
+    /**
+     * @brief Claim, fill and publish one slot.
+     * @return true if the point was written, false if it was dropped.
+     */
+    template<typename... Args>
+    bool publish(const Args &... args) noexcept {
+        if (!mHeader)
+            return false;
+        auto &header = *mHeader;
+        auto slotCount = mMask + 1;
+        auto claimed = header.writeIndex.load(std::memory_order_relaxed);
+        for (unsigned attempt = 0;; ++attempt) {
+            if (attempt == ClaimAttempts || claimed - header.readIndex.load(std::memory_order_acquire) >= slotCount)
+                return drop();
+            if (header.writeIndex.compare_exchange_weak(claimed, claimed + 1, std::memory_order_relaxed,
+                                                        std::memory_order_relaxed))
+                break;
+        }
+
+        auto &slot = mSlots[claimed & mMask];
+        for (auto expected = tag(claimed, Free); !slot.state.compare_exchange_weak(
+                expected, tag(claimed, Writing), std::memory_order_acquire, std::memory_order_acquire);) {
+            if (expected == tag(claimed, Free))
+                continue;
+            // Abandoned before it was marked, the slot is still this writer's to release.
+            if (expected == tag(claimed, Abandoned)) {
+                release(slot, expected);
+                return drop();
+            }
+            // Still held by a writer of an earlier lap, it releases the slot once this position is marked.
+            if (position(expected) < claimed
+                && !slot.state.compare_exchange_strong(expected, tag(claimed, Skipped), std::memory_order_relaxed,
+                                                       std::memory_order_acquire))
+                continue;
+            return drop();
+        }
+
+        // The slot is this writer's until it publishes or releases it, even if the reader abandons it, so
+        // the data and length written here can not collide with another writer or be read half written.
+        auto [end, fits] = ysh::composite::writeAll(slot.data, slot.data + LineCapacity, args..., '\n');
+        slot.length = fits ? static_cast<std::uint32_t>(end - slot.data) : 0;
+        auto expected = tag(claimed, Writing);
+        if (!slot.state.compare_exchange_strong(expected, tag(claimed, Ready), std::memory_order_release,
+                                                std::memory_order_relaxed)) {
+            release(slot, expected);
+            return drop();
+        }
+        return fits ? true : drop();
+    }
+
+public:
+    /**
+     * @brief An unavailable ring, every write is dropped.
+     */
+    InfluxTelemetryRing() = default;
+
+    /**
+     * @brief Map a ring file, creating it if it does not exist.
+     * @details If the file cannot be created or mapped, or was made by an incompatible version, the ring is
+     * unavailable rather than an error, so telemetry can never stop a tool from working.
+     * @param path The ring file.
+     * @param slotCount The number of slots of a new ring, rounded up to a power of two. An existing ring
+     * keeps its own size.
+     */
+    explicit InfluxTelemetryRing(const std::filesystem::path &path, std::uint32_t slotCount = DefaultSlots);
+
+    InfluxTelemetryRing(const InfluxTelemetryRing &) = delete;
+    InfluxTelemetryRing &operator=(const InfluxTelemetryRing &) = delete;
+
+    ~InfluxTelemetryRing();
+
+    /**
+     * @brief The default ring file, DefaultName in XDGFilePaths::XDG_RUNTIME_DIR.
+     * @return The path, or std::nullopt if XDG_RUNTIME_DIR is not set.
+     */
+    static std::optional<std::filesystem::path> defaultPath();
+
+    /**
+     * @brief The process wide ring at defaultPath(), mapped on first use and never unmapped.
+     */
+    static InfluxTelemetryRing &instance();
+
+    /**
+     * @brief Test if the ring is mapped.
+     */
+    explicit operator bool() const { return mHeader != nullptr; }
+
+    [[nodiscard]] std::uint32_t capacity() const { return static_cast<std::uint32_t>(mHeader ? mMask + 1 : 0); }
+
+    /**
+     * @brief Write one line protocol line, the trailing newline is optional.
+     * @return true if written, false if dropped because it is empty or holds more than one line.
+     */
+    bool write(std::string_view line) noexcept {
+        if (!line.empty() && line.back() == '\n')
+            line.remove_suffix(1);
+        if (line.empty() || line.find_first_of("\n\r") != std::string_view::npos)
+            return drop();
+        return publish(line);
+    }
+
+    /**
+     * @brief Write one measurement line: prefix name=value timeStamp, as InfluxPush::addMeasurement().
+     * @return true if written, false if dropped.
+     */
+    bool add(std::string_view prefix, std::string_view name, std::string_view value,
+             unsigned long long timeStamp) noexcept {
+        if (name.empty() || value.empty())
+            return false;
+        return publish(prefix, name, '=', value, ' ', timeStamp);
+    }
+
+    /**
+     * @brief Write one measurement line with a numeric value, integers as InfluxDB integer fields.
+     * @return true if written, false if dropped, including values influxRepresentable() refuses.
+     */
+    template<InfluxNumeric Value>
+    bool add(std::string_view prefix, std::string_view name, Value value, unsigned long long timeStamp) noexcept {
+        if (name.empty())
+            return false;
+        if (!influxRepresentable(value))
+            return drop();
+        if constexpr (std::is_integral_v<Value>)
+            return publish(prefix, name, '=', value, 'i', ' ', timeStamp);
+        else
+            return publish(prefix, name, '=', value, ' ', timeStamp);
+    }
+
+    /**
+     * @brief Become the reader of the ring.
+     * @return false if the ring is unavailable or another process is the reader.
+     */
+    bool attachReader();
+
+    /**
+     * @brief Append published lines, in position order, without releasing their slots.
+     * @details Stops at the first slot that is claimed but not yet published. Once the same slot has been
+     * waited on for holeTimeout it is abandoned and reading continues past it. Reader only.
+     * @param out The buffer the lines are appended to.
+     * @param maxLines The most lines to append.
+     * @param holeTimeout How long a claimed slot may stay unpublished.
+     * @return The number of slots consumed, including abandoned and empty ones.
+     */
+    std::size_t read(InfluxLineBuffer &out, std::size_t maxLines,
+                     std::chrono::nanoseconds holeTimeout = std::chrono::milliseconds{250});
+
+    /**
+     * @brief Release every slot read() has consumed to the writers. Reader only.
+     */
+    void commit();
+
+    [[nodiscard]] TelemetryRingStats stats() const;
+};
+
+#endif //ECOBEEDATA_INFLUXTELEMETRYRING_H
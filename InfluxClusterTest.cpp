@@ -0,0 +1,251 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * InfluxClusterTest.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file InfluxClusterTest.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Exercise InfluxCluster against InfluxDB stand-ins on loopback.
+ * @details Three minimal HTTP servers accept /write requests and count the lines posted. The last one waits
+ * longer than the push timeout before it answers. Flushes to the other two must not be held up by it: they
+ * must receive every line sent to them, and the slow endpoint's breaker must open with its batches held,
+ * as batches are not rerouted. A fourth server refuses every batch with 400 Bad Request, its batches must be
+ * released without retries and without opening its breaker. The program returns non-zero if any check fails.
+ */
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include "BetterMain/BMain.h"
+#include "Influx/InfluxCluster.h"
+
+namespace {
+
+    /**
+     * @class StandIn
+     * @brief An HTTP server that answers every request with a fixed status, 204 No Content by default, after an
+     * optional delay.
+     */
+    class StandIn {
+    private:
+        int mSocket{-1};
+        long mPort{0};
+        std::chrono::milliseconds mDelay;
+        std::string mResponse;
+        std::atomic<std::size_t> mLines{0};
+        std::atomic<bool> mStop{false};
+        std::thread mThread{};
+
+        void serve() {
+            while (!mStop) {
+                auto connection = accept(mSocket, nullptr, nullptr);
+                if (connection < 0)
+                    continue;
+                std::string request{};
+                std::array<char, 4096> buffer{};
+                std::size_t bodyStart = std::string::npos;
+                std::size_t contentLength = 0;
+                while (bodyStart == std::string::npos || request.size() < bodyStart + contentLength) {
+                    auto count = read(connection, buffer.data(), buffer.size());
+                    if (count <= 0)
+                        break;
+                    request.append(buffer.data(), static_cast<std::size_t>(count));
+                    if (bodyStart == std::string::npos) {
+                        if (auto end = request.find("\r\n\r\n"); end != std::string::npos) {
+                            bodyStart = end + 4;
+                            if (auto length = request.find("Content-Length: "); length < end)
+                                contentLength = std::stoul(request.substr(length + 16));
+                        }
+                    }
+                }
+                if (bodyStart != std::string::npos)
+                    mLines += static_cast<std::size_t>(std::count(request.begin() + static_cast<long>(bodyStart),
+                                                                  request.end(), '\n'));
+                std::this_thread::sleep_for(mDelay);
+                [[maybe_unused]] auto written = write(connection, mResponse.data(), mResponse.size());
+                close(connection);
+            }
+        }
+
+    public:
+        explicit StandIn(std::chrono::milliseconds delay, std::string_view status = "204 No Content")
+                : mDelay(delay),
+                  mResponse(ysh::StringComposite("HTTP/1.1 ", status,
+                                                 "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n")) {
+            mSocket = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            socklen_t length = sizeof(address);
+            if (mSocket < 0 || bind(mSocket, reinterpret_cast<sockaddr *>(&address), length) != 0
+                || listen(mSocket, 16) != 0
+                || getsockname(mSocket, reinterpret_cast<sockaddr *>(&address), &length) != 0)
+                throw std::runtime_error("Unable to open stand-in server socket.");
+            mPort = ntohs(address.sin_port);
+            mThread = std::thread{&StandIn::serve, this};
+        }
+
+        ~StandIn() {
+            mStop = true;
+            shutdown(mSocket, SHUT_RDWR);
+            close(mSocket);
+            mThread.join();
+        }
+
+        [[nodiscard]] long port() const { return mPort; }
+
+        [[nodiscard]] std::size_t lines() const { return mLines; }
+    };
+
+    const char *breakerName(InfluxCluster::Breaker breaker) {
+        switch (breaker) {
+            case InfluxCluster::Breaker::Closed:
+                return "closed";
+            case InfluxCluster::Breaker::Open:
+                return "open";
+            case InfluxCluster::Breaker::HalfOpen:
+                return "half-open";
+        }
+        return "";
+    }
+
+    /**
+     * @brief Run one mode against two fast and one slow stand-in.
+     * @return The number of failed checks.
+     */
+    int exercise(InfluxCluster::Mode mode, const char *modeName) {
+        using namespace std::chrono_literals;
+        std::vector<std::unique_ptr<StandIn>> standIns{};
+        standIns.push_back(std::make_unique<StandIn>(0ms));
+        standIns.push_back(std::make_unique<StandIn>(0ms));
+        standIns.push_back(std::make_unique<StandIn>(2000ms));
+
+        std::vector<InfluxEndpoint> endpoints{};
+        for (auto &standIn : standIns)
+            endpoints.push_back(InfluxEndpoint{"127.0.0.1", false, standIn->port(), "test"});
+
+        InfluxCluster::Options options{};
+        options.timeout = 250ms;
+        options.failureThreshold = 2;
+        InfluxCluster cluster{endpoints, mode, options};
+
+        auto begin = std::chrono::steady_clock::now();
+        constexpr std::size_t Flushes = 5;
+        constexpr std::size_t SeriesCount = 100;
+        std::vector<std::size_t> expected(standIns.size(), 0);
+        for (std::size_t series = 0; series < SeriesCount; ++series) {
+            auto prefix = ysh::StringComposite("sensor,id=", series, ' ');
+            if (mode == InfluxCluster::Mode::Replicate)
+                for (auto &lines : expected)
+                    lines += Flushes;
+            else
+                expected[cluster.endpointFor(prefix, "value")] += Flushes;
+        }
+        for (std::size_t flush = 0; flush < Flushes; ++flush) {
+            for (std::size_t series = 0; series < SeriesCount; ++series)
+                cluster.addMeasurement(ysh::StringComposite("sensor,id=", series, ' '), "value",
+                                       static_cast<double>(flush), 1700000000000000000ULL + flush);
+            cluster.flush();
+        }
+        auto drained = cluster.drain(5s);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+
+        std::cout << modeName << ": " << Flushes * SeriesCount << " lines, drained " << std::boolalpha << drained
+                  << " in " << elapsed.count() << " ms\n";
+        for (std::size_t idx = 0; idx < cluster.size(); ++idx) {
+            auto health = cluster.health(idx);
+            std::cout << "  endpoint " << idx << ": lines received " << standIns[idx]->lines()
+                      << ", sent " << health.batchesSent << ", failed " << health.batchesFailed
+                      << ", queued " << health.batchesQueued << ", dropped " << health.batchesDropped
+                      << ", rejected " << health.batchesRejected
+                      << ", breaker " << breakerName(health.breaker) << '\n';
+        }
+
+        int failures = 0;
+        auto expect = [&failures, modeName](bool condition, std::size_t idx, std::string_view what) {
+            if (!condition) {
+                std::cerr << "Failed: " << modeName << " endpoint " << idx << ' ' << what << '\n';
+                ++failures;
+            }
+        };
+        expect(drained, 0, "drain did not finish");
+        auto slow = standIns.size() - 1;
+        for (std::size_t idx = 0; idx < slow; ++idx) {
+            auto health = cluster.health(idx);
+            expect(standIns[idx]->lines() == expected[idx], idx, "did not receive every line sent to it");
+            expect(health.batchesSent == Flushes && health.batchesFailed == 0, idx, "did not send every batch");
+            expect(health.batchesQueued == 0 && health.batchesDropped == 0, idx, "held or dropped batches");
+            expect(health.breaker == InfluxCluster::Breaker::Closed, idx, "breaker is not closed");
+        }
+        auto health = cluster.health(slow);
+        expect(health.breaker == InfluxCluster::Breaker::Open, slow, "breaker did not open");
+        expect(health.batchesSent == 0 && health.batchesFailed >= options.failureThreshold, slow,
+               "did not fail its sends");
+        expect(health.batchesQueued + health.batchesDropped == Flushes, slow, "did not hold or drop every batch");
+        return failures;
+    }
+
+    /**
+     * @brief Send to a stand-in that refuses every batch.
+     * @return The number of failed checks.
+     */
+    int rejection() {
+        using namespace std::chrono_literals;
+        StandIn standIn{0ms, "400 Bad Request"};
+        InfluxCluster::Options options{};
+        options.timeout = 250ms;
+        options.failureThreshold = 2;
+        InfluxCluster cluster{{InfluxEndpoint{"127.0.0.1", false, standIn.port(), "test"}},
+                              InfluxCluster::Mode::Shard, options};
+
+        constexpr std::size_t Flushes = 5;
+        for (std::size_t flush = 0; flush < Flushes; ++flush) {
+            cluster.addMeasurement("sensor,id=0 ", "value", static_cast<double>(flush), 1700000000000000000ULL + flush);
+            cluster.flush();
+        }
+        auto drained = cluster.drain(5s);
+        auto health = cluster.health(0);
+        std::cout << "rejected: drained " << std::boolalpha << drained << ", lines received " << standIn.lines()
+                  << ", rejected " << health.batchesRejected << ", failed " << health.batchesFailed
+                  << ", breaker " << breakerName(health.breaker) << '\n';
+
+        int failures = 0;
+        auto expect = [&failures](bool condition, std::string_view what) {
+            if (!condition) {
+                std::cerr << "Failed: rejected endpoint " << what << '\n';
+                ++failures;
+            }
+        };
+        expect(drained && health.batchesQueued == 0, "held refused batches");
+        expect(health.batchesRejected == Flushes && standIn.lines() == Flushes, "retried or lost refused batches");
+        expect(health.batchesFailed == 0 && health.consecutiveFailures == 0, "counted refusals as failures");
+        expect(health.breaker == InfluxCluster::Breaker::Closed, "breaker is not closed");
+        return failures;
+    }
+}
+
+namespace better_main {
+    [[nodiscard]] int start(std::span<const std::string_view>) noexcept {
+        try {
+            auto failures = exercise(InfluxCluster::Mode::Shard, "shard");
+            failures += exercise(InfluxCluster::Mode::Replicate, "replicate");
+            failures += rejection();
+            std::cout << (failures ? "FAIL" : "PASS") << ": cluster endpoints isolated from a slow node.\n";
+            return failures ? 1 : 0;
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << '\n';
+            return 1;
+        }
+    }
+}
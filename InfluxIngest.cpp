@@ -0,0 +1,461 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * InfluxIngest.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file InfluxIngest.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Stream a large line protocol or CSV file into InfluxDB.
+ * @details The input is mapped into memory and cut into batches of at most --batch bytes on line
+ * boundaries. Batches are pushed by --jobs threads, each with its own connection. The byte offset up to
+ * which every batch has been accepted is written to the --checkpoint file, and a run with the same
+ * checkpoint resumes from there. With --dry-run the batches are written to a local file instead.
+ *
+ * CSV input, selected with --csv <measurement>, has a header row naming the columns. The first column is
+ * the time stamp in nanoseconds from epoch, the rest are numeric fields. Empty cells are skipped.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include "BetterMain/BMain.h"
+#include "BetterMain/BMainHelp.h"
+#include "File/FileDescriptor.h"
+#include "Influx/InfluxPush.h"
+#include "Influx/InfluxSeries.h"
+#include "ysh/ObjectPool.h"
+
+enum class ArgIdx : size_t {
+    FreeArg,
+    Help,
+    Host,
+    Port,
+    Tls,
+    DataBase,
+    Batch,
+    Jobs,
+    Checkpoint,
+    DryRun,
+    Csv,
+    ArgCount
+};
+
+namespace better_main {
+    static constexpr std::array<better_main::BMainArg<ArgIdx>,static_cast<size_t>(ArgIdx::ArgCount)> ProgramArgs = {{
+        { ArgIdx::FreeArg, ArgType::FreeArg, '\0', "", "", ""},
+        { ArgIdx::Help, ArgType::Help, 'h', "help", "Display program or option help.", ""},
+        { ArgIdx::Host, ArgType::Host, 'H', "host", "InfluxDB host name, default localhost.", ""},
+        { ArgIdx::Port, ArgType::Integer, 'p', "port", "InfluxDB port, default 8086.", ""},
+        { ArgIdx::Tls, ArgType::NoValue, 's', "tls", "Connect with TLS.", ""},
+        { ArgIdx::DataBase, ArgType::String, 'd', "database", "InfluxDB database name.", ""},
+        { ArgIdx::Batch, ArgType::Integer, 'b', "batch", "Maximum batch size in bytes, default 4 MiB.", ""},
+        { ArgIdx::Jobs, ArgType::Integer, 'j', "jobs", "Concurrent requests, default 4.", ""},
+        { ArgIdx::Checkpoint, ArgType::Path, 'c', "checkpoint", "Resume from and record progress in a file.", ""},
+        { ArgIdx::DryRun, ArgType::Path, 'n', "dry-run", "Write batches to a file instead of pushing them.", ""},
+        { ArgIdx::Csv, ArgType::String, 'm', "csv", "Input is CSV, give the measurement name.", ""},
+    }};
+}
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @class MappedFile
+     * @brief A read only memory mapping of a whole file.
+     */
+    class MappedFile {
+    private:
+        const char *mData{nullptr};
+        std::size_t mSize{0};
+
+    public:
+        explicit MappedFile(const std::filesystem::path &path) {
+            ysh::FileDescriptor fd{open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+            struct stat statBuf{};
+            if (!fd || fstat(fd.get(), &statBuf) != 0)
+                throw std::runtime_error(ysh::StringComposite("Unable to open ", path));
+            mSize = static_cast<std::size_t>(statBuf.st_size);
+            if (mSize) {
+                auto data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+                if (data == MAP_FAILED)
+                    throw std::runtime_error(ysh::StringComposite("Unable to map ", path));
+                madvise(data, mSize, MADV_SEQUENTIAL);
+                mData = static_cast<const char *>(data);
+            }
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        ~MappedFile() {
+            if (mData)
+                munmap(const_cast<char *>(mData), mSize);
+        }
+
+        [[nodiscard]] std::string_view view() const { return {mData, mSize}; }
+    };
+
+    /**
+     * @struct Batch
+     * @brief A run of whole lines of the input.
+     */
+    struct Batch {
+        std::size_t begin{};
+        std::size_t end{};
+    };
+
+    /**
+     * @brief Find the end of the batch starting at an offset, on a line boundary.
+     */
+    std::size_t batchEnd(std::string_view input, std::size_t begin, std::size_t maxBytes) {
+        auto limit = std::min(input.size(), begin + maxBytes);
+        if (limit == input.size())
+            return limit;
+        if (auto newline = input.rfind('\n', limit - 1); newline != std::string_view::npos && newline >= begin)
+            return newline + 1;
+        // A line longer than the batch size is sent on its own.
+        auto newline = input.find('\n', limit);
+        return newline == std::string_view::npos ? input.size() : newline + 1;
+    }
+
+    /**
+     * @brief Convert CSV rows to line protocol.
+     * @param measurement The measurement name, escaped.
+     * @param columns The column names, escaped as field names.
+     */
+    void csvToLines(std::string_view rows, std::string_view measurement, const std::vector<std::string> &columns,
+                    std::string &out) {
+        auto buffer = ysh::ObjectPool<InfluxLineBuffer>::instance().acquire();
+        auto &lines = *buffer;
+        while (!rows.empty()) {
+            auto newline = rows.find('\n');
+            auto row = rows.substr(0, newline);
+            rows.remove_prefix(newline == std::string_view::npos ? rows.size() : newline + 1);
+            if (!row.empty() && row.back() == '\r')
+                row.remove_suffix(1);
+            auto comma = row.find(',');
+            auto timeStamp = row.substr(0, comma);
+            if (timeStamp.empty() || comma == std::string_view::npos)
+                continue;
+
+            char separator = ' ';
+            lines.append(measurement);
+            for (std::size_t column = 1; comma != std::string_view::npos && column < columns.size(); ++column) {
+                auto next = row.find(',', comma + 1);
+                auto cell = row.substr(comma + 1, next == std::string_view::npos ? std::string_view::npos
+                                                                                 : next - comma - 1);
+                if (!cell.empty()) {
+                    lines.append(separator, columns[column], '=', cell);
+                    separator = ',';
+                }
+                comma = next;
+            }
+            if (separator == ' ')
+                lines.clear();      // No fields, not a valid line.
+            else
+                lines.append(' ', timeStamp, '\n');
+            out.append(lines.view());
+            lines.clear();
+        }
+    }
+
+    /**
+     * @class Ingest
+     * @brief Cut the input into batches and push them with a pool of sender threads.
+     */
+    class Ingest {
+    private:
+        std::string_view mInput;
+        std::size_t mBatchBytes;
+        std::size_t mJobs;
+        std::optional<std::filesystem::path> mCheckpoint;
+        std::optional<std::string> mCsvMeasurement;        ///< Escaped.
+        std::vector<std::string> mCsvColumns{};             ///< Escaped.
+        std::function<std::unique_ptr<InfluxPush>()> mMakePush;
+        ysh::FileDescriptor mDryRun{};
+
+        std::mutex mMutex{};
+        std::condition_variable mSignal{};
+        std::deque<Batch> mQueue{};
+        std::map<std::size_t, std::size_t> mCompleted{};   ///< Accepted batches beyond the checkpoint.
+        std::size_t mCommitted{0};                          ///< Every byte before this has been accepted.
+        bool mDone{false};
+        bool mFailed{false};
+        bool mCheckpointFailed{false};
+
+        std::atomic<std::size_t> mBytesSent{0};
+        std::atomic<std::size_t> mLinesSent{0};
+        std::atomic<std::size_t> mRetries{0};
+
+        /**
+         * @brief Replace the checkpoint file, called on sender threads with the lock held.
+         * @details The new checkpoint is synced before it replaces the old one, so a crash leaves one or the
+         * other. A failure is reported once and the run continues, as every batch it covers was delivered.
+         */
+        void writeCheckpoint() {
+            if (!mCheckpoint)
+                return;
+            auto temporary = *mCheckpoint;
+            temporary += ".tmp";
+            auto text = ysh::StringComposite(mCommitted, '\n');
+            std::error_code ec{};
+            errno = 0;
+            {
+                ysh::FileDescriptor fd{open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+                if (!fd || write(fd.get(), text.data(), text.size()) != static_cast<ssize_t>(text.size())
+                    || fsync(fd.get()) != 0)
+                    ec.assign(errno ? errno : EIO, std::generic_category());
+            }
+            if (!ec)
+                std::filesystem::rename(temporary, *mCheckpoint, ec);
+            if (ec && !mCheckpointFailed) {
+                mCheckpointFailed = true;
+                std::cerr << "Unable to write the checkpoint " << *mCheckpoint << ": " << ec.message() << '\n';
+            }
+        }
+
+        void completed(const Batch &batch) {
+            mCompleted.emplace(batch.begin, batch.end);
+            auto advanced = false;
+            for (auto next = mCompleted.find(mCommitted); next != mCompleted.end(); next = mCompleted.find(mCommitted)) {
+                mCommitted = next->second;
+                mCompleted.erase(next);
+                advanced = true;
+            }
+            if (advanced)
+                writeCheckpoint();
+        }
+
+        bool deliver(InfluxPush *push, const std::string &payload) {
+            if (!push) {
+                std::lock_guard<std::mutex> lock{mMutex};
+                for (auto written = std::size_t{0}; written < payload.size();) {
+                    auto count = write(mDryRun.get(), payload.data() + written, payload.size() - written);
+                    if (count < 0)
+                        return false;
+                    written += static_cast<std::size_t>(count);
+                }
+                return true;
+            }
+            // Only a failed push is retried, one InfluxDB rejected would be rejected again.
+            for (int attempt = 0; attempt < 4; ++attempt) {
+                if (attempt) {
+                    ++mRetries;
+                    std::this_thread::sleep_for(std::chrono::milliseconds{250} * (1 << attempt));
+                }
+                switch (push->push(payload)) {
+                    case InfluxPush::PushResult::Accepted:
+                        return true;
+                    case InfluxPush::PushResult::Rejected:
+                        return false;
+                    case InfluxPush::PushResult::Failed:
+                        break;
+                }
+            }
+            return false;
+        }
+
+        void send() {
+            auto push = mDryRun ? nullptr : mMakePush();
+            std::string payload{};
+            std::unique_lock<std::mutex> lock{mMutex};
+            while (true) {
+                mSignal.wait(lock, [this] { return !mQueue.empty() || mDone || mFailed; });
+                if (mFailed || mQueue.empty())
+                    return;
+                auto batch = mQueue.front();
+                mQueue.pop_front();
+                mSignal.notify_all();
+                lock.unlock();
+
+                auto text = mInput.substr(batch.begin, batch.end - batch.begin);
+                payload.clear();
+                if (mCsvMeasurement)
+                    csvToLines(text, *mCsvMeasurement, mCsvColumns, payload);
+                else
+                    payload.assign(text);
+                auto delivered = deliver(push.get(), payload);
+                if (delivered) {
+                    mBytesSent += payload.size();
+                    mLinesSent += static_cast<std::size_t>(std::count(payload.begin(), payload.end(), '\n'));
+                }
+
+                lock.lock();
+                if (delivered) {
+                    completed(batch);
+                } else {
+                    std::cerr << "Batch at offset " << batch.begin << " could not be delivered.\n";
+                    mFailed = true;
+                    mSignal.notify_all();
+                }
+            }
+        }
+
+    public:
+        Ingest(std::string_view input, std::size_t batchBytes, std::size_t jobs,
+               std::optional<std::filesystem::path> checkpoint, std::optional<std::string> csvMeasurement,
+               std::function<std::unique_ptr<InfluxPush>()> makePush, std::optional<std::filesystem::path> dryRun)
+                : mInput(input), mBatchBytes(std::max(batchBytes, std::size_t{1})), mJobs(std::max(jobs, std::size_t{1})),
+                  mCheckpoint(std::move(checkpoint)), mMakePush(std::move(makePush)) {
+            if (dryRun) {
+                mDryRun.reset(open(dryRun->c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644));
+                if (!mDryRun)
+                    throw std::runtime_error(ysh::StringComposite("Unable to open ", *dryRun));
+            }
+
+            if (mCheckpoint && std::filesystem::exists(*mCheckpoint)) {
+                std::ifstream in{*mCheckpoint};
+                in >> mCommitted;
+                if (!in || mCommitted > mInput.size() || (mCommitted && mInput[mCommitted - 1] != '\n'))
+                    throw std::runtime_error(ysh::StringComposite("Checkpoint ", *mCheckpoint,
+                                                                  " does not match the input."));
+            }
+
+            if (csvMeasurement) {
+                mCsvMeasurement.emplace();
+                InfluxSeriesRegistry::appendMeasurement(*mCsvMeasurement, *csvMeasurement);
+                auto header = mInput.substr(0, mInput.find('\n'));
+                if (!header.empty() && header.back() == '\r')
+                    header.remove_suffix(1);
+                for (std::size_t first = 0; first <= header.size();) {
+                    auto comma = std::min(header.find(',', first), header.size());
+                    InfluxSeriesRegistry::appendKey(mCsvColumns.emplace_back(), header.substr(first, comma - first));
+                    first = comma + 1;
+                }
+                if (mCommitted == 0)
+                    mCommitted = std::min(header.size() + 1, mInput.size());
+            }
+        }
+
+        /**
+         * @brief Push every batch from the checkpoint to the end of the input.
+         * @return true if all batches were delivered.
+         */
+        bool run() {
+            auto start = Clock::now();
+            std::vector<std::thread> senders{};
+            for (std::size_t job = 0; job < mJobs; ++job)
+                senders.emplace_back(&Ingest::send, this);
+
+            auto nextReport = start + std::chrono::seconds{5};
+            for (auto begin = mCommitted; begin < mInput.size();) {
+                Batch batch{begin, batchEnd(mInput, begin, mBatchBytes)};
+                std::unique_lock<std::mutex> lock{mMutex};
+                mSignal.wait(lock, [this] { return mQueue.size() < mJobs * 2 || mFailed; });
+                if (mFailed)
+                    break;
+                mQueue.push_back(batch);
+                mSignal.notify_all();
+                begin = batch.end;
+
+                if (auto now = Clock::now(); now >= nextReport) {
+                    report(std::cerr, now - start, mCommitted);
+                    nextReport = now + std::chrono::seconds{5};
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock{mMutex};
+                mDone = true;
+            }
+            mSignal.notify_all();
+            for (auto &sender : senders)
+                sender.join();
+
+            report(std::cout, Clock::now() - start, mCommitted);
+            return !mFailed;
+        }
+
+        /**
+         * @brief Write a throughput report.
+         * @param committed The checkpoint offset, read with the lock held.
+         */
+        void report(std::ostream &out, Clock::duration elapsed, std::size_t committed) {
+            auto seconds = std::chrono::duration<double>(elapsed).count();
+            auto bytes = static_cast<double>(mBytesSent.load());
+            auto lines = static_cast<double>(mLinesSent.load());
+            out << std::fixed << std::setprecision(1)
+                << bytes / 1048576.0 << " MiB, " << lines << " lines in " << seconds << " s: "
+                << (seconds > 0 ? bytes / 1048576.0 / seconds : 0.0) << " MiB/s, "
+                << (seconds > 0 ? lines / seconds : 0.0) << " lines/s, " << mRetries.load() << " retries";
+            if (committed)
+                out << ", checkpoint " << committed << " of " << mInput.size();
+            out << '\n';
+        }
+    };
+}
+
+namespace better_main {
+    [[nodiscard]] int start(std::span<const std::string_view> args) noexcept {
+        try {
+            auto invocation = parseArgs(args, ProgramArgs);
+            if (Help<ProgramArgs>::print(invocation))
+                return 0;
+
+            std::optional<std::filesystem::path> input{};
+            for (const auto &arg : invocation)
+                if (arg.argType == ArgType::FreeArg)
+                    input = arg.value;
+            auto dataBase = findArgument(invocation, ArgIdx::DataBase);
+            auto dryRun = findArgument(invocation, ArgIdx::DryRun);
+            if (!input || (!dataBase && !dryRun)) {
+                std::cerr << "Usage: " << args.front() << " [options] <input file>\n";
+                Help<ProgramArgs>::print(STDERR_FILENO);
+                return 1;
+            }
+
+            auto value = [&invocation](ArgIdx idx) -> std::optional<std::string> {
+                if (auto arg = findArgument(invocation, idx))
+                    return arg->value;
+                return std::nullopt;
+            };
+            auto host = value(ArgIdx::Host).value_or("localhost");
+            auto port = numericValue<long>(value(ArgIdx::Port).value_or("8086")).value;
+            auto tls = findArgument(invocation, ArgIdx::Tls).has_value();
+            auto dataBaseName = value(ArgIdx::DataBase).value_or("");
+            auto positive = [&value](ArgIdx idx, std::string_view option, const char *fallback) {
+                auto number = numericValue<long>(value(idx).value_or(fallback)).value;
+                if (number <= 0)
+                    throw std::runtime_error(ysh::StringComposite("--", option, " must be greater than zero."));
+                return static_cast<std::size_t>(number);
+            };
+            auto batchBytes = positive(ArgIdx::Batch, "batch", "4194304");
+            auto jobs = positive(ArgIdx::Jobs, "jobs", "4");
+            std::optional<std::filesystem::path> checkpoint{};
+            if (auto path = value(ArgIdx::Checkpoint))
+                checkpoint = *path;
+            std::optional<std::filesystem::path> dryRunPath{};
+            if (dryRun)
+                dryRunPath = dryRun->value;
+
+            cURLpp::Cleanup cleanup{};
+            MappedFile mapped{*input};
+            Ingest ingest{mapped.view(), batchBytes, jobs, checkpoint, value(ArgIdx::Csv),
+                          [&]() {
+                              auto push = std::make_unique<InfluxPush>(host, tls, port, dataBaseName);
+                              push->setTimeout(std::chrono::seconds{60});
+                              return push;
+                          }, dryRunPath};
+            return ingest.run() ? 0 : 2;
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << '\n';
+            return 1;
+        }
+    }
+}
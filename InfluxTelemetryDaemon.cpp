@@ -0,0 +1,275 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * InfluxTelemetryDaemon.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file InfluxTelemetryDaemon.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Drain the shared memory telemetry ring into InfluxDB.
+ * @details Tools write points into an InfluxTelemetryRing without waiting, this resident program is its
+ * reader. It runs in the foreground, for a service manager to supervise, and only one instance may read a
+ * ring. Every --interval milliseconds, or at once while the ring holds a full batch, up to --batch lines are
+ * pushed in one request. Slots are released only after the push is accepted, so points survive both an
+ * InfluxDB outage, until the ring fills, and a restart of this program. Failed pushes are retried with
+ * backoff. A batch InfluxDB rejects as malformed is never retried, it is logged, appended to the --rejected
+ * file if one is given, and released. SIGINT or SIGTERM delivers what is in the ring and exits.
+ */
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <optional>
+#include <utility>
+#include "BetterMain/BMain.h"
+#include "BetterMain/BMainHelp.h"
+#include "File/FileDescriptor.h"
+#include "Influx/InfluxPush.h"
+#include "Influx/InfluxTelemetryRing.h"
+
+enum class ArgIdx : size_t {
+    FreeArg,
+    Help,
+    Host,
+    Port,
+    Tls,
+    DataBase,
+    Ring,
+    Interval,
+    Batch,
+    DryRun,
+    Rejected,
+    ArgCount
+};
+
+namespace better_main {
+    static constexpr std::array<better_main::BMainArg<ArgIdx>,static_cast<size_t>(ArgIdx::ArgCount)> ProgramArgs = {{
+        { ArgIdx::FreeArg, ArgType::FreeArg, '\0', "", "", ""},
+        { ArgIdx::Help, ArgType::Help, 'h', "help", "Display program or option help.", ""},
+        { ArgIdx::Host, ArgType::Host, 'H', "host", "InfluxDB host name, default localhost.", ""},
+        { ArgIdx::Port, ArgType::Integer, 'p', "port", "InfluxDB port, default 8086.", ""},
+        { ArgIdx::Tls, ArgType::NoValue, 's', "tls", "Connect with TLS.", ""},
+        { ArgIdx::DataBase, ArgType::String, 'd', "database", "InfluxDB database name.", ""},
+        { ArgIdx::Ring, ArgType::Path, 'r', "ring", "Ring file, default in XDG_RUNTIME_DIR.", ""},
+        { ArgIdx::Interval, ArgType::Integer, 'i', "interval", "Milliseconds between pushes, default 1000.", ""},
+        { ArgIdx::Batch, ArgType::Integer, 'b', "batch", "Maximum lines per push, default 5000.", ""},
+        { ArgIdx::DryRun, ArgType::Path, 'n', "dry-run", "Write batches to a file instead of pushing them.", ""},
+        { ArgIdx::Rejected, ArgType::Path, 'R', "rejected", "Append batches InfluxDB rejects to a file.", ""},
+    }};
+}
+
+namespace {
+
+    using namespace std::chrono_literals;
+
+    constexpr auto MaxBackoff = std::chrono::milliseconds{30s};
+
+    /**
+     * @brief Wait for a termination signal, which must be blocked.
+     * @return true if one arrived within the timeout.
+     */
+    bool waitForSignal(const sigset_t &signals, std::chrono::milliseconds timeout) {
+        auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+        timespec delay{static_cast<time_t>(seconds.count()),
+                       static_cast<long>(std::chrono::nanoseconds{timeout - seconds}.count())};
+        return sigtimedwait(&signals, nullptr, &delay) > 0;
+    }
+
+    bool writeAll(int fd, std::string_view data) {
+        for (std::size_t written = 0; written < data.size();) {
+            auto count = write(fd, data.data() + written, data.size() - written);
+            if (count < 0)
+                return false;
+            written += static_cast<std::size_t>(count);
+        }
+        return true;
+    }
+
+    /**
+     * @class Relay
+     * @brief Move batches from the ring to InfluxDB, or to a dry run file.
+     */
+    class Relay {
+    private:
+        InfluxTelemetryRing &mRing;
+        std::unique_ptr<InfluxPush> mPush;
+        ysh::FileDescriptor mDryRun;
+        ysh::FileDescriptor mRejectedFile;
+        std::size_t mBatchLines;
+        InfluxLineBuffer mBatch{};
+        std::size_t mPending{0};            ///< Slots read into mBatch and not yet committed.
+        std::size_t mFailures{0};
+        std::size_t mRejected{0};
+
+        InfluxPush::PushResult deliver() {
+            if (mBatch.empty())
+                return InfluxPush::PushResult::Accepted;
+            if (mPush)
+                return mPush->push(mBatch.str());
+            return writeAll(mDryRun.get(), mBatch.view()) ? InfluxPush::PushResult::Accepted
+                                                          : InfluxPush::PushResult::Failed;
+        }
+
+    public:
+        Relay(InfluxTelemetryRing &ring, std::unique_ptr<InfluxPush> push, ysh::FileDescriptor dryRun,
+              ysh::FileDescriptor rejected, std::size_t batchLines)
+                : mRing(ring), mPush(std::move(push)), mDryRun(std::move(dryRun)), mRejectedFile(std::move(rejected)),
+                  mBatchLines(std::max(batchLines, std::size_t{1})) {}
+
+        /**
+         * @brief Read a batch, unless one is still waiting to be delivered, and try to deliver it.
+         * @details A rejected batch is released like a delivered one, retrying it would stop the ring from
+         * draining for good.
+         * @return The number of slots delivered or rejected and released, or std::nullopt if the push failed.
+         */
+        std::optional<std::size_t> step() {
+            if (mPending == 0)
+                mPending = mRing.read(mBatch, mBatchLines);
+            if (mPending == 0)
+                return 0;
+            switch (deliver()) {
+                case InfluxPush::PushResult::Failed:
+                    ++mFailures;
+                    return std::nullopt;
+                case InfluxPush::PushResult::Rejected:
+                    ++mRejected;
+                    std::cerr << "InfluxDB rejected a batch, ";
+                    if (!mRejectedFile)
+                        std::cerr << "discarded.\n";
+                    else if (writeAll(mRejectedFile.get(), mBatch.view()))
+                        std::cerr << "saved.\n";
+                    else
+                        std::cerr << "unable to save it, discarded.\n";
+                    break;
+                case InfluxPush::PushResult::Accepted:
+                    break;
+            }
+            mRing.commit();
+            mBatch.clear();
+            return std::exchange(mPending, 0);
+        }
+
+        [[nodiscard]] std::size_t failures() const { return mFailures; }
+
+        [[nodiscard]] std::size_t rejected() const { return mRejected; }
+    };
+}
+
+namespace better_main {
+    [[nodiscard]] int start(std::span<const std::string_view> args) noexcept {
+        try {
+            auto invocation = parseArgs(args, ProgramArgs);
+            if (Help<ProgramArgs>::print(invocation))
+                return 0;
+
+            auto value = [&invocation](ArgIdx idx) -> std::optional<std::string> {
+                if (auto arg = findArgument(invocation, idx))
+                    return arg->value;
+                return std::nullopt;
+            };
+            auto dataBase = value(ArgIdx::DataBase);
+            auto dryRun = value(ArgIdx::DryRun);
+            if (!dataBase && !dryRun) {
+                std::cerr << "Usage: " << args.front() << " [options]\n";
+                Help<ProgramArgs>::print(STDERR_FILENO);
+                return 1;
+            }
+
+            std::optional<std::filesystem::path> ringPath{};
+            if (auto path = value(ArgIdx::Ring))
+                ringPath = *path;
+            else
+                ringPath = InfluxTelemetryRing::defaultPath();
+            if (!ringPath) {
+                std::cerr << "XDG_RUNTIME_DIR is not set, give the ring file with --ring.\n";
+                return 1;
+            }
+            InfluxTelemetryRing ring{*ringPath};
+            if (!ring) {
+                std::cerr << "Unable to map the telemetry ring " << *ringPath << ".\n";
+                return 1;
+            }
+            if (!ring.attachReader()) {
+                std::cerr << "Another process is reading the telemetry ring " << *ringPath << ".\n";
+                return 1;
+            }
+
+            auto positive = [&value](ArgIdx idx, std::string_view option, const char *fallback) {
+                auto number = numericValue<long>(value(idx).value_or(fallback)).value;
+                if (number <= 0)
+                    throw std::runtime_error(ysh::StringComposite("--", option, " must be greater than zero."));
+                return number;
+            };
+            auto interval = std::chrono::milliseconds{positive(ArgIdx::Interval, "interval", "1000")};
+            auto batchLines = static_cast<std::size_t>(positive(ArgIdx::Batch, "batch", "5000"));
+
+            cURLpp::Cleanup cleanup{};
+            std::unique_ptr<InfluxPush> push{};
+            ysh::FileDescriptor dryRunFd{};
+            ysh::FileDescriptor rejectedFd{};
+            if (auto rejected = value(ArgIdx::Rejected)) {
+                rejectedFd.reset(open(rejected->c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644));
+                if (!rejectedFd)
+                    throw std::runtime_error(ysh::StringComposite("Unable to open ", *rejected));
+            }
+            if (dryRun) {
+                dryRunFd.reset(open(dryRun->c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644));
+                if (!dryRunFd)
+                    throw std::runtime_error(ysh::StringComposite("Unable to open ", *dryRun));
+            } else {
+                push = std::make_unique<InfluxPush>(value(ArgIdx::Host).value_or("localhost"),
+                                                    findArgument(invocation, ArgIdx::Tls).has_value(),
+                                                    numericValue<long>(value(ArgIdx::Port).value_or("8086")).value,
+                                                    *dataBase);
+                push->setTimeout(10s);
+            }
+
+            // Termination signals are taken synchronously, as the wait between pushes.
+            sigset_t signals{};
+            sigemptyset(&signals);
+            sigaddset(&signals, SIGINT);
+            sigaddset(&signals, SIGTERM);
+            sigprocmask(SIG_BLOCK, &signals, nullptr);
+
+            Relay relay{ring, std::move(push), std::move(dryRunFd), std::move(rejectedFd), batchLines};
+            auto backoff = interval;
+            for (auto stopping = false; !stopping;) {
+                if (auto delivered = relay.step()) {
+                    backoff = interval;
+                    // A full batch means the ring is filling faster than the interval, go again at once.
+                    if (*delivered < batchLines)
+                        stopping = waitForSignal(signals, interval);
+                } else {
+                    std::cerr << "Push failed, retrying in " << backoff.count() << " ms.\n";
+                    stopping = waitForSignal(signals, backoff);
+                    backoff = std::min(backoff * 2, MaxBackoff);
+                }
+            }
+
+            // Deliver what is in the ring, at most one ring full. Anything undelivered stays for the next run.
+            for (std::size_t total = 0; total < ring.capacity();) {
+                auto delivered = relay.step();
+                if (!delivered || *delivered == 0)
+                    break;
+                total += *delivered;
+            }
+
+            auto stats = ring.stats();
+            std::cout << stats.committed << " of " << stats.written << " points delivered, " << stats.dropped
+                      << " dropped, " << stats.abandoned << " abandoned, " << relay.failures()
+                      << " failed pushes, " << relay.rejected() << " rejected batches.\n";
+            return 0;
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << '\n';
+            return 1;
+        }
+    }
+}
@@ -7,13 +7,24 @@
 
 #pragma once
 
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <algorithm>
 
 /**
  * @class InputParser
  * @brief Parse command line arguments.
+ * @details Tokens are held as views into argv, which outlives the parser. The constructor builds a flat open
+ * addressing index from each distinct token to its first position, so every query is one hash and usually
+ * one comparison, and option() and cmdOptionExists() do not allocate. The strings getCmdOption() returns
+ * are made by the constructor too, nothing is modified after construction and every query is safe to make
+ * from several threads.
  */
 class InputParser {
 public:
@@ -22,31 +33,82 @@ public:
      * @param argc The number of command line arguments passed to the application
      * @param argv The array of command line arguments.
      */
-    InputParser(int &argc, char **argv) {
-        programPathName = argv[0];
+    InputParser(int argc, const char *const *argv) {
+        if (argc > 0)
+            programPathName = argv[0];
         for (int i = 1; i < argc; ++i)
-            this->tokens.emplace_back(argv[i]);
+            tokens.emplace_back(argv[i]);
+        buildIndex();
+    }
+
+    InputParser(int &argc, char **argv) : InputParser(argc, static_cast<const char *const *>(argv)) {}
+
+    /**
+     * @brief Constructor from the arguments passed to better_main::start().
+     */
+    explicit InputParser(std::span<const std::string_view> args) {
+        if (!args.empty()) {
+            programPathName = args.front();
+            tokens.assign(std::next(args.begin()), args.end());
+        }
+        buildIndex();
+    }
+
+    /**
+     * @brief Get the token following the first occurrence of an option.
+     * @param option The option.
+     * @return A view of the value, empty if the option is not present or is the last token.
+     */
+    [[nodiscard]] std::optional<std::string_view> option(std::string_view option) const {
+        if (auto position = find(option); position && *position + 1 < tokens.size())
+            return tokens[*position + 1];
+        return std::nullopt;
     }
 
     /// @author iain
     [[nodiscard]] const std::string &getCmdOption(const std::string_view &option) const {
-        std::vector<std::string>::const_iterator itr;
-        itr = std::find(this->tokens.begin(), this->tokens.end(), option);
-        if (itr != this->tokens.end() && ++itr != this->tokens.end()) {
-            return *itr;
-        }
+        if (auto position = find(option); position && *position + 1 < tokens.size())
+            return materialized[*position + 1];
         static const std::string empty_string;
         return empty_string;
     }
 
     /// @author iain
     [[nodiscard]] bool cmdOptionExists(const std::string_view &option) const {
-        return std::find(this->tokens.begin(), this->tokens.end(), option)
-               != this->tokens.end();
+        return find(option).has_value();
     }
 
     std::string programPathName{};
 
 private:
-    std::vector<std::string> tokens;
+    static constexpr std::uint32_t EmptySlot = 0;
+
+    std::vector<std::string_view> tokens;
+    std::vector<std::uint32_t> index{};             ///< Token position + 1, or EmptySlot.
+    std::vector<std::string> materialized{};        ///< The tokens as strings, for getCmdOption().
+
+    void buildIndex() {
+        index.assign(std::bit_ceil(std::max<std::size_t>(tokens.size() * 2, 8)), EmptySlot);
+        materialized.assign(tokens.begin(), tokens.end());
+        auto mask = index.size() - 1;
+        for (std::size_t position = 0; position < tokens.size(); ++position) {
+            auto slot = std::hash<std::string_view>{}(tokens[position]) & mask;
+            for (; index[slot] != EmptySlot; slot = (slot + 1) & mask)
+                if (tokens[index[slot] - 1] == tokens[position])
+                    break;
+            if (index[slot] == EmptySlot)
+                index[slot] = static_cast<std::uint32_t>(position + 1);
+        }
+    }
+
+    /**
+     * @brief The position of the first occurrence of a token.
+     */
+    [[nodiscard]] std::optional<std::size_t> find(std::string_view option) const {
+        auto mask = index.size() - 1;
+        for (auto slot = std::hash<std::string_view>{}(option) & mask; index[slot] != EmptySlot; slot = (slot + 1) & mask)
+            if (tokens[index[slot] - 1] == option)
+                return index[slot] - 1;
+        return std::nullopt;
+    }
 };
@@ -0,0 +1,157 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * ResidentTest.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file ResidentTest.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Check that requests served by the better_main resident server do not see each other's input.
+ * @details Run without arguments the program is the test driver. It makes a private XDG_RUNTIME_DIR and
+ * runs itself with --echo and better_main::ResidentEnvVar set, piping a different input to each run. The
+ * first run starts the server, the later ones must be served by it, and each must read the first line of
+ * its own input even though the server read ahead past it in the previous request.
+ */
+
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BetterMain/BMain.h"
+
+namespace {
+
+    struct Run {
+        pid_t child{-1};
+        int status{-1};
+        std::string output{};
+    };
+
+    /**
+     * @brief Run this program with --echo, the given input and environment, and collect its output.
+     */
+    std::optional<Run> run(const std::string &input, std::vector<std::string> &environment) {
+        int in[2], out[2];
+        if (pipe2(in, O_CLOEXEC) != 0 || pipe2(out, O_CLOEXEC) != 0)
+            return std::nullopt;
+        posix_spawn_file_actions_t actions{};
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, in[0], STDIN_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+
+        std::string program{std::filesystem::read_symlink("/proc/self/exe")};
+        std::vector<char *> argv{program.data(), const_cast<char *>("--echo"), nullptr};
+        std::vector<char *> envp{};
+        for (auto &env : environment)
+            envp.push_back(env.data());
+        envp.push_back(nullptr);
+
+        Run result{};
+        auto spawned = posix_spawn(&result.child, program.c_str(), &actions, nullptr, argv.data(), envp.data());
+        posix_spawn_file_actions_destroy(&actions);
+        close(in[0]);
+        close(out[1]);
+        if (spawned != 0) {
+            close(in[1]);
+            close(out[0]);
+            return std::nullopt;
+        }
+        // The input is far smaller than a pipe buffer, it is written whole before anything is read.
+        [[maybe_unused]] auto written = write(in[1], input.data(), input.size());
+        close(in[1]);
+        char buffer[256];
+        for (ssize_t count; (count = read(out[0], buffer, sizeof(buffer))) > 0;)
+            result.output.append(buffer, static_cast<std::size_t>(count));
+        close(out[0]);
+        waitpid(result.child, &result.status, 0);
+        return result;
+    }
+
+    int drive() {
+        char templ[] = "/tmp/resident-test-XXXXXX";
+        if (mkdtemp(templ) == nullptr) {
+            std::cerr << "Unable to make a runtime directory.\n";
+            return 1;
+        }
+        std::filesystem::path runtimeDir{templ};
+
+        std::vector<std::string> environment{};
+        for (auto env = environ; *env; ++env) {
+            std::string_view entry{*env};
+            if (!entry.starts_with("XDG_RUNTIME_DIR=") && !entry.starts_with(better_main::ResidentEnvVar))
+                environment.emplace_back(entry);
+        }
+        environment.push_back(ysh::StringComposite("XDG_RUNTIME_DIR=", runtimeDir));
+        environment.push_back(ysh::StringComposite(better_main::ResidentEnvVar, "=10"));
+
+        auto serverRunning = [&runtimeDir]() {
+            for (auto &entry : std::filesystem::directory_iterator{runtimeDir})
+                if (entry.path().extension() == ".sock")
+                    return true;
+            return false;
+        };
+
+        int failures = 0;
+        pid_t server{0};
+        for (int request = 0; request < 4; ++request) {
+            auto line = ysh::StringComposite("request ", request);
+            auto runResult = run(ysh::StringComposite(line, "\nread ahead ", request, '\n'), environment);
+            if (!runResult || !WIFEXITED(runResult->status) || WEXITSTATUS(runResult->status) != 0) {
+                std::cerr << "Request " << request << " did not run.\n";
+                ++failures;
+                continue;
+            }
+            auto &output = runResult->output;
+            auto space = output.find(' ');
+            auto pid = space == std::string::npos ? pid_t{0} : static_cast<pid_t>(std::stol(output.substr(0, space)));
+            auto echo = space == std::string::npos ? output : output.substr(space + 1);
+            if (echo != ysh::StringComposite(line, '\n')) {
+                std::cerr << "Request " << request << " read '" << echo << "' instead of its own input.\n";
+                ++failures;
+            }
+            if (request == 0) {
+                // The first request runs itself and starts the server.
+                for (int wait = 0; wait < 200 && !serverRunning(); ++wait)
+                    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+            } else if (pid == runResult->child) {
+                std::cerr << "Request " << request << " was not served by the resident server.\n";
+                ++failures;
+            } else {
+                server = pid;
+            }
+        }
+
+        if (server > 0)
+            kill(server, SIGTERM);
+        std::error_code ec{};
+        std::filesystem::remove_all(runtimeDir, ec);
+        std::cout << (failures ? "FAIL" : "PASS") << ": resident requests read only their own input.\n";
+        return failures ? 1 : 0;
+    }
+}
+
+namespace better_main {
+    [[nodiscard]] int start(std::span<const std::string_view> args) noexcept {
+        if (args.size() > 1 && args[1] == "--echo") {
+            // Read one line, stdio reads the rest of the small input ahead into its buffer.
+            std::string line{};
+            std::getline(std::cin, line);
+            std::cout << getpid() << ' ' << line << '\n';
+            return 0;
+        }
+        return drive();
+    }
+}
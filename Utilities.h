@@ -1,8 +1,10 @@
 
-#include <sstream>
+#include "File/StringComposite.h"
 
 /**
 * @brief Composite a pack of arguments that are streamable to a string.
+* @details Retained for existing callers, this is ysh::StringComposite(). See ysh::StringStreamComposite() for
+* the output that changed.
 * @tparam Arg First argument type
 * @tparam Args Rest of the argument types
 * @param arg First argument
@@ -11,9 +13,6 @@
 */
 template<typename Arg, typename... Args>
 inline std::string StringCompositor(Arg &&arg, Args &&... args) {
-    std::stringstream out;
-    out << std::forward<Arg>(arg);
-    ((out << std::forward<Args>(args)), ...);
-    return out.str();
+    return ysh::StringComposite(std::forward<Arg>(arg), std::forward<Args>(args)...);
 }
 
@@ -7,69 +7,241 @@
 
 #include "XDGFilePaths.h"
 #include <cstdlib>
-#include <sstream>
+#include <future>
 #include <iostream>
+#include <thread>
+#include <ThreadPool.h>
 
 namespace xdg {
 
     XDGFilePaths::XDGFilePaths() {
-        mHome = getenv("HOME");
-        for (const auto &path : mEnvVars) {
-            bool inEnvironment{false};
-            std::string envValue;
-            auto env = getenv(std::string{path.varName}.c_str());
-            if (env) {
-                envValue = std::string{env};
-                inEnvironment = true;
-            } else {
-                envValue = path.defaultPath;
+        if (auto home = getenv("HOME"); home)
+            mHome = home;
+    }
+
+    XDGFilePaths::XDGFilePaths(const XDGFilePaths &other) : mHome(other.mHome) {
+        for (const auto &spec : mEnvVars) {
+            mPaths[spec.name] = other.paths(spec.name);
+            std::call_once(mParsed[spec.name], []() {});
+        }
+    }
+
+    XDGFilePaths &XDGFilePaths::operator=(const XDGFilePaths &other) {
+        if (this != &other) {
+            mHome = other.mHome;
+            // A once_flag can not be reset, a name this object already parsed is simply overwritten.
+            for (const auto &spec : mEnvVars) {
+                std::call_once(mParsed[spec.name], []() {});
+                mPaths[spec.name] = other.paths(spec.name);
             }
+        }
+        return *this;
+    }
+
+    void XDGFilePaths::parse(XDG_Name name) const {
+        const auto &spec = mEnvVars[name];
+        // The variable names are string literals, so data() is null terminated.
+        auto env = getenv(spec.varName.data());
+        bool inEnvironment = env != nullptr;
+        std::string_view envValue = inEnvironment ? std::string_view{env} : spec.defaultPath;
+
+        auto &pathSet = mPaths[name];
+        while (!envValue.empty()) {
+            auto end = envValue.find(':');
+            auto value = envValue.substr(0, end);
+            envValue = end == std::string_view::npos ? std::string_view{} : envValue.substr(end + 1);
+            if (value.empty())
+                continue;
 
-            XDG_Path_Set pathSet{};
-            std::stringstream strm{envValue};
-            std::string value{};
-            while (std::getline(strm, value, ':')) {
-                if (!inEnvironment && path.homeRelative) {
-                    std::filesystem::path pathValue{mHome};
-                    pathValue.append(value);
-                    pathSet.push_back(pathValue);
-                } else {
-                    std::filesystem::path pathValue{value};
-                    pathSet.push_back(pathValue);
-                }
+            if (!inEnvironment && spec.homeRelative) {
+                pathSet.emplace_back(mHome) /= value;
+            } else {
+                pathSet.emplace_back(value);
             }
-            mPaths[path.name] = pathSet;
         }
     }
 
+    const std::vector<ysh::FileDescriptor> &XDGResolver::directories(XDGFilePaths::XDG_Name name) {
+        std::call_once(mOpened[name], [this, name]() {
+            for (const auto &base : mFilePaths.paths(name))
+                mDirectories[name].emplace_back(::open(base.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC));
+        });
+        return mDirectories[name];
+    }
+
+    XDGResolver::Resolved XDGResolver::open(XDGFilePaths::XDG_Name name, const std::filesystem::path &relativePath,
+                                            int flags) {
+        const auto &bases = directories(name);
+        for (std::size_t idx = 0; idx < bases.size(); ++idx) {
+            if (!bases[idx])
+                continue;
+            if (auto fd = ::openat(bases[idx].get(), relativePath.c_str(), flags); fd >= 0)
+                return Resolved{ysh::FileDescriptor{fd}, idx};
+        }
+        return Resolved{};
+    }
+
+    std::optional<std::size_t> XDGResolver::locate(XDGFilePaths::XDG_Name name, const std::filesystem::path &relativePath,
+                                                   struct stat *statBuf) {
+        struct stat localBuf{};
+        const auto &bases = directories(name);
+        for (std::size_t idx = 0; idx < bases.size(); ++idx) {
+            if (bases[idx] && ::fstatat(bases[idx].get(), relativePath.c_str(), statBuf ? statBuf : &localBuf, 0) == 0)
+                return idx;
+        }
+        return std::nullopt;
+    }
+
+    int XDGResolver::directory(XDGFilePaths::XDG_Name name, std::size_t baseIndex) {
+        const auto &bases = directories(name);
+        return baseIndex < bases.size() ? bases[baseIndex].get() : -1;
+    }
+
     std::filesystem::path Environment::getenv_path(XDGFilePaths::XDG_Name name, const std::string &appName, bool create) {
-        auto [found,path] = mFilePaths.findFilePath(name, appName);
+        auto [found,path] = findFilePath(name, appName);
         if (!found && create) {
             std::filesystem::create_directories(path);
+            mResolutions.with([&](auto &resolutions) {
+                if (auto resolution = resolutions.find(resolutionKey(name, appName)); resolution != resolutions.end())
+                    resolution->second.found = true;
+            });
         }
         return path;
     }
 
-    Environment::Environment(bool daemonMode) {
+    Environment::~Environment() {
+        // Stop the watcher thread before the cache it invalidates is destroyed.
+        mResolutionWatcher.reset();
+    }
+
+    std::tuple<bool, std::filesystem::path> Environment::resolve(XDGFilePaths::XDG_Name name,
+                                                                 const std::filesystem::path &relativePath) {
+        if (mResolutionWatcher) {
+            std::call_once(mResolutionWatched[name], [this, name]() {
+                for (const auto &base : mFilePaths.paths(name))
+                    mResolutionWatcher->watch(base);
+            });
+        }
+
+        mResolutionMisses.fetch_add(1, std::memory_order_relaxed);
+        auto ttl = Clock::duration{mResolutionTtl.load(std::memory_order_relaxed)};
+        auto [found, path] = mFilePaths.findFilePath(name, relativePath);
+        if (ttl > Clock::duration::zero()) {
+            mResolutions.with([&, found = found, &path = path](auto &resolutions) {
+                resolutions.insert_or_assign(resolutionKey(name, relativePath),
+                                             Resolution{found, path, Clock::now() + ttl});
+            });
+        }
+        return {found, path};
+    }
+
+    std::tuple<bool, std::filesystem::path> Environment::findFilePath(XDGFilePaths::XDG_Name name,
+                                                                      const std::filesystem::path &relativePath) {
+        auto cached = mResolutions.with([&](auto &resolutions) -> std::optional<std::tuple<bool, std::filesystem::path>> {
+            if (auto resolution = resolutions.find(resolutionKey(name, relativePath)); resolution != resolutions.end()) {
+                if (resolution->second.expires > Clock::now())
+                    return std::make_tuple(resolution->second.found, resolution->second.path);
+                resolutions.erase(resolution);
+            }
+            return std::nullopt;
+        });
+
+        if (cached) {
+            mResolutionHits.fetch_add(1, std::memory_order_relaxed);
+            return cached.value();
+        }
+        return resolve(name, relativePath);
+    }
+
+    void Environment::prefetch(const std::vector<std::pair<XDGFilePaths::XDG_Name, std::filesystem::path>> &resources) {
+        ysh::ThreadPool::instance().parallel_for(resources, [this](const auto &resource) {
+            resolve(resource.first, resource.second);
+        }, 1);
+    }
+
+    bool Environment::watchResolutions() {
+        if (!mResolutionWatcher) {
+            auto watcher = std::make_unique<ysh::InotifyWatcher>([this](const std::filesystem::path &, std::string_view) {
+                invalidateResolutions();
+            });
+            if (!*watcher)
+                return false;
+            mResolutionWatcher = std::move(watcher);
+        }
+        return true;
+    }
+
+    void Environment::invalidateResolutions() {
+        mResolutionInvalidations.fetch_add(1, std::memory_order_relaxed);
+        mResolutions.with([](auto &resolutions) { resolutions.clear(); });
+    }
+
+    Environment::Environment(bool daemonMode, StartupMode startupMode) {
+        auto begin = Clock::now();
+        auto timed = [](auto &&phase) {
+            auto start = Clock::now();
+            phase();
+            return Clock::now() - start;
+        };
+
         if (!daemonMode)
-            mHomeDirectory = std::string{getenv("HOME")};
+            if (auto home = getenv("HOME"); home)
+                mHomeDirectory = home;
+
         std::filesystem::path procExec{"/proc"};
         procExec.append("self").append("exe");
 
-        if (std::filesystem::is_symlink(procExec)) {
-            mAppName = std::filesystem::read_symlink(procExec).filename().string();
+        std::error_code ec{};
+        mStartupTimings.appName = timed([&]() {
+            if (auto exe = std::filesystem::read_symlink(procExec, ec); !ec)
+                mAppName = exe.filename().string();
+        });
 
-            if (!daemonMode) {
-                mDataHome = getenv_path(XDGFilePaths::XDG_DATA_HOME, mAppName, true);
-                mConfigHome = getenv_path(XDGFilePaths::XDG_CONFIG_HOME, mAppName, true);
-                mCacheHome = getenv_path(XDGFilePaths::XDG_CACHE_HOME, mAppName, true);
-            }
-            mAppResources = getenv_path(XDGFilePaths::XDG_DATA_DIRS, mAppName, false);
-            mLibResources = getenv_path(XDGFilePaths::XDG_DATA_DIRS, "Rose/resources", false);
-        } else {
+        if (ec) {
             std::cerr << StringCompositor('"', procExec, '"', " is not a symbolic link to application.\n");
+            mStartupTimings.total = Clock::now() - begin;
             return;
         }
+
+        if (!daemonMode) {
+            auto provision = [this, &timed](XDGFilePaths::XDG_Name name, std::filesystem::path &path) {
+                return timed([&]() { path = getenv_path(name, mAppName, true); });
+            };
+
+            if (startupMode == StartupMode::Concurrent) {
+                // Two short lived threads, not the process wide pool. The std::async futures join when
+                // destroyed, so if a provision throws no task is left running against this frame.
+                auto data = std::async(std::launch::async, [&]() {
+                    return provision(XDGFilePaths::XDG_DATA_HOME, mDataHome);
+                });
+                auto config = std::async(std::launch::async, [&]() {
+                    return provision(XDGFilePaths::XDG_CONFIG_HOME, mConfigHome);
+                });
+                mStartupTimings.cacheHome = provision(XDGFilePaths::XDG_CACHE_HOME, mCacheHome);
+                mStartupTimings.dataHome = data.get();
+                mStartupTimings.configHome = config.get();
+            } else {
+                mStartupTimings.dataHome = provision(XDGFilePaths::XDG_DATA_HOME, mDataHome);
+                mStartupTimings.configHome = provision(XDGFilePaths::XDG_CONFIG_HOME, mConfigHome);
+                mStartupTimings.cacheHome = provision(XDGFilePaths::XDG_CACHE_HOME, mCacheHome);
+            }
+        }
+
+        if (startupMode == StartupMode::Serial)
+            resolveResources();
+
+        mStartupTimings.total = Clock::now() - begin;
+    }
+
+    void Environment::resolveResources() const {
+        std::call_once(mResourcesResolved, [this]() {
+            if (mAppName.empty())
+                return;
+            auto begin = Clock::now();
+            mAppResources = std::get<1>(mFilePaths.findFilePath(XDGFilePaths::XDG_DATA_DIRS, mAppName));
+            mLibResources = std::get<1>(mFilePaths.findFilePath(XDGFilePaths::XDG_DATA_DIRS, "Rose/resources"));
+            mResourcesTime.store((Clock::now() - begin).count(), std::memory_order_release);
+        });
     }
 
 }
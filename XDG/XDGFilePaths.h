@@ -7,13 +7,24 @@
 
 #pragma once
 
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
-#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <optional>
+#include <FileDescriptor.h>
+#include <InotifyWatcher.h>
+#include <MutexGuarded.h>
 #include <Permissions.h>
+#include <PermissionCache.h>
+#include <StringComposite.h>
 
 namespace xdg {
 
@@ -44,7 +55,7 @@ namespace xdg {
 
         using XDG_Path_Set = std::vector<std::filesystem::path>;
 
-        using XDG_Paths = std::map<XDG_Name, XDG_Path_Set>;
+        using XDG_Paths = std::array<XDG_Path_Set, 6>;
 
     protected:
         static constexpr XDG_Env_Var_List mEnvVars = {
@@ -56,14 +67,43 @@ namespace xdg {
                 XDG_Env_Spec{XDG_RUNTIME_DIR, "XDG_RUNTIME_DIR", "", false}
         };
 
-        XDG_Paths mPaths{};     ///< All the XDG specified paths.
+        static_assert(mEnvVars[XDG_RUNTIME_DIR].name == XDG_RUNTIME_DIR, "mEnvVars must be indexed by XDG_Name.");
+
+        mutable XDG_Paths mPaths{};                         ///< All the XDG specified paths, parsed on first use.
+
+        mutable std::array<std::once_flag, 6> mParsed{};    ///< Set when the matching entry of mPaths is parsed.
 
         std::string mHome;      ///< User's home directory.
 
+        /**
+         * @brief Parse the environment variable, or default, of an XDG name into mPaths.
+         */
+        void parse(XDG_Name name) const;
+
     public:
 
         XDGFilePaths();
 
+        /**
+         * @brief Copy the parsed paths of another XDGFilePaths.
+         * @details Every name of the source is parsed first so the copy sees the same paths and does not read
+         * the environment again.
+         */
+        XDGFilePaths(const XDGFilePaths &other);
+
+        XDGFilePaths& operator=(const XDGFilePaths &other);
+
+        /**
+         * @brief Get the search paths of an XDG name.
+         * @details The environment variable is parsed the first time the name is used.
+         * @param name The XDG name
+         * @return The paths in order of preference, which may be empty.
+         */
+        [[nodiscard]] const XDG_Path_Set& paths(XDG_Name name) const {
+            std::call_once(mParsed[name], [this, name]() { parse(name); });
+            return mPaths[name];
+        }
+
         /**
          * @brief Search for a relative path on one of the XDG standard locations.
          * @details If the relative path is found below one of the specified paths in the named location, the
@@ -75,22 +115,47 @@ namespace xdg {
          * @return A std::tuple<bool,std::filesystem::path>
          */
         template<typename S>
-        std::tuple<bool,std::filesystem::path> findFilePath(XDG_Name name, const S &relativePath) {
-            for (auto const &path : mPaths[name]) {
-                auto tryPath{path};
-                tryPath.append(relativePath);
-                if (std::filesystem::exists(tryPath))
-                    return std::make_tuple(true,tryPath);
+        std::tuple<bool,std::filesystem::path> findFilePath(XDG_Name name, const S &relativePath) const {
+            std::filesystem::path result{};
+            auto found = findFilePath(name, relativePath, result);
+            return std::make_tuple(found, std::move(result));
+        }
+
+        /**
+         * @brief Search for a relative path on one of the XDG standard locations, into a caller supplied path.
+         * @details As findFilePath(name, relativePath) but the result is assigned to a path owned by the caller,
+         * reusing its storage, so a caller that searches repeatedly with the same result path does not copy the
+         * search paths or allocate once the result has grown large enough. If the name has no search paths
+         * the result is the relative path.
+         * @tparam S The type of the relative path, implicitly convertible to a std::filesystem::path.
+         * @param name The XDG name
+         * @param relativePath A path relative to an XDG location to search for.
+         * @param result Set to the path found, or the path in the preferred directory.
+         * @return true if the path was found.
+         */
+        template<typename S>
+        bool findFilePath(XDG_Name name, const S &relativePath, std::filesystem::path &result) const {
+            const auto &pathSet = paths(name);
+            std::error_code ec{};
+            for (auto const &path : pathSet) {
+                result = path;
+                result /= relativePath;
+                if (std::filesystem::exists(result, ec))
+                    return true;
             }
 
-            auto preferredPath{mPaths[name].front()};
-            preferredPath.append(relativePath);
-            return std::make_tuple(false, preferredPath);
+            if (pathSet.empty())
+                result = relativePath;
+            else
+                (result = pathSet.front()) /= relativePath;
+            return false;
         }
     };
 
     /**
     * @brief Composite a pack of arguments that are streamable to a string.
+    * @details Retained for existing callers, this is ysh::StringComposite(). See ysh::StringStreamComposite() for
+    * the output that changed.
     * @tparam Arg First argument type
     * @tparam Args Rest of the argument types
     * @param arg First argument
@@ -99,34 +164,181 @@ namespace xdg {
     */
     template<typename Arg, typename... Args>
     std::string StringCompositor(Arg &&arg, Args &&... args) {
-        std::stringstream out;
-        out << std::forward<Arg>(arg);
-        ((out << std::forward<Args>(args)), ...);
-        return out.str();
+        return ysh::StringComposite(std::forward<Arg>(arg), std::forward<Args>(args)...);
     }
 
+    /**
+     * @class XDGResolver
+     * @brief Resolve resources relative to XDG base directories through open directory file descriptors.
+     * @details Each base directory of an XDG name is opened once, with O_PATH|O_DIRECTORY, the first time the
+     * name is used. Resources are then found with openat(2) or fstatat(2) relative to those descriptors, so the
+     * kernel only walks the relative part of the path, and a resource that is opened is the one that was found.
+     * Base directories that do not exist when first used are skipped.
+     */
+    class XDGResolver {
+    public:
+        /**
+         * @struct Resolved
+         * @brief An opened resource and the index of the base directory it was found under.
+         */
+        struct Resolved {
+            ysh::FileDescriptor fd{};
+            std::size_t baseIndex{};
+
+            explicit operator bool() const { return static_cast<bool>(fd); }
+        };
+
+    private:
+        const XDGFilePaths &mFilePaths;
+        std::array<std::vector<ysh::FileDescriptor>, 6> mDirectories{};  ///< Indexed as XDGFilePaths::paths().
+        std::array<std::once_flag, 6> mOpened{};
+
+        const std::vector<ysh::FileDescriptor> &directories(XDGFilePaths::XDG_Name name);
+
+    public:
+        explicit XDGResolver(const XDGFilePaths &filePaths) : mFilePaths(filePaths) {}
+
+        XDGResolver(const XDGResolver &) = delete;
+        XDGResolver &operator=(const XDGResolver &) = delete;
+
+        /**
+         * @brief Open a resource below the first base directory of an XDG name that contains it.
+         * @param name The XDG name.
+         * @param relativePath The resource path relative to the base directories.
+         * @param flags Flags for openat(2). Use O_PATH for a lightweight handle to a resource that will not
+         * be read.
+         * @return The open resource, or an empty Resolved if it was not found in any base directory.
+         */
+        Resolved open(XDGFilePaths::XDG_Name name, const std::filesystem::path &relativePath,
+                      int flags = O_RDONLY | O_CLOEXEC);
+
+        /**
+         * @brief Find the first base directory of an XDG name that contains a resource, without opening it.
+         * @param name The XDG name.
+         * @param relativePath The resource path relative to the base directories.
+         * @param statBuf If not null, set to the status of the resource found.
+         * @return The index of the base directory in XDGFilePaths::paths(name), or std::nullopt.
+         */
+        std::optional<std::size_t> locate(XDGFilePaths::XDG_Name name, const std::filesystem::path &relativePath,
+                                          struct stat *statBuf = nullptr);
+
+        /**
+         * @brief Get the open descriptor of a base directory.
+         * @return The descriptor, or -1 if the directory could not be opened.
+         */
+        int directory(XDGFilePaths::XDG_Name name, std::size_t baseIndex);
+
+        /**
+         * @brief Compose the absolute path of a located resource, for messages and legacy interfaces.
+         */
+        [[nodiscard]] std::filesystem::path path(XDGFilePaths::XDG_Name name, std::size_t baseIndex,
+                                                 const std::filesystem::path &relativePath) const {
+            return mFilePaths.paths(name).at(baseIndex) / relativePath;
+        }
+    };
+
     class Environment {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /**
+         * @enum StartupMode
+         * @brief How the Environment constructor provisions the user directories.
+         */
+        enum class StartupMode {
+            Serial,         ///< Find or create each directory in turn and resolve the resource directories.
+            Concurrent,     ///< Find or create the user directories concurrently and defer the resource
+                            ///< directories until they are first used.
+        };
+
+        /**
+         * @struct StartupTimings
+         * @brief Wall clock time spent in each phase of Environment construction.
+         * @details Phases that did not run, or in Concurrent mode have not run yet, are zero. In Concurrent mode
+         * the user directory phases overlap, so total may be less than their sum.
+         */
+        struct StartupTimings {
+            Clock::duration appName{};          ///< Reading the application name from /proc/self/exe.
+            Clock::duration dataHome{};         ///< Finding or creating the data home directory.
+            Clock::duration configHome{};       ///< Finding or creating the config home directory.
+            Clock::duration cacheHome{};        ///< Finding or creating the cache home directory.
+            Clock::duration resources{};        ///< Resolving the application and library resource directories.
+            Clock::duration total{};            ///< The constructor, not including deferred resources.
+        };
+
+        /**
+         * @brief The default time a resolution is remembered for.
+         */
+        static constexpr Clock::duration DefaultResolutionTtl = std::chrono::seconds{5};
+
+        /**
+         * @struct ResolutionStats
+         * @brief Resolution cache counters.
+         */
+        struct ResolutionStats {
+            std::uint64_t hits{0};              ///< Resolutions answered from the cache, found or not.
+            std::uint64_t misses{0};            ///< Resolutions that probed the filesystem.
+            std::uint64_t invalidations{0};     ///< Times the cache was cleared by an event or a call.
+        };
+
     protected:
-        explicit Environment(bool daemonMode);
+        explicit Environment(bool daemonMode, StartupMode startupMode = StartupMode::Serial);
+
+        /**
+         * @brief Resolve mAppResources and mLibResources, once.
+         */
+        void resolveResources() const;
+
+        /**
+         * @struct Resolution
+         * @brief The remembered result of a findFilePath() search, found or not.
+         */
+        struct Resolution {
+            bool found{false};
+            std::filesystem::path path{};
+            Clock::time_point expires{};
+        };
+
+        ysh::MutexGuarded<std::unordered_map<std::string, Resolution>> mResolutions{};   ///< By resolutionKey().
+        std::atomic<Clock::rep> mResolutionTtl{DefaultResolutionTtl.count()};
+        std::atomic<std::uint64_t> mResolutionHits{0};
+        std::atomic<std::uint64_t> mResolutionMisses{0};
+        std::atomic<std::uint64_t> mResolutionInvalidations{0};
+        std::unique_ptr<ysh::InotifyWatcher> mResolutionWatcher{};  ///< Set by watchResolutions().
+        std::array<std::once_flag, 6> mResolutionWatched{};
+
+        static std::string resolutionKey(XDGFilePaths::XDG_Name name, const std::filesystem::path &relativePath) {
+            return ysh::StringComposite(static_cast<char>('0' + name), relativePath);
+        }
+
+        /**
+         * @brief Search the file system and remember the result.
+         */
+        std::tuple<bool, std::filesystem::path> resolve(XDGFilePaths::XDG_Name name,
+                                                        const std::filesystem::path &relativePath);
 
         std::filesystem::path mHomeDirectory{};     ///< The user's home directory path
         std::filesystem::path mDataHome{};          ///< The user's XDG Data Home path
         std::filesystem::path mConfigHome{};        ///< The user's XDG Config Home path
         std::filesystem::path mCacheHome{};         ///< The user's XDG Cache Home path
-        std::filesystem::path mAppResources;        ///< Resources installed with the application.
+        mutable std::filesystem::path mAppResources;    ///< Resources installed with the application.
 
         /**
          * @brief Resources shared by applications using the library.
          * @details The content of this directory is maintained by the library developer. Any user data
          * placed or installed in this directory may be over written by updates.
          */
-        std::filesystem::path mLibResources;
+        mutable std::filesystem::path mLibResources;
+        mutable std::once_flag mResourcesResolved{};
+        mutable std::atomic<Clock::rep> mResourcesTime{0};
+        StartupTimings mStartupTimings{};
         XDGFilePaths mFilePaths{};                  ///< XDG Spec file paths.
+        XDGResolver mResolver{mFilePaths};          ///< Descriptor based resolution below mFilePaths.
 
         std::string mAppName;                       ///< Application name as provided by the system.
 
     public:
-        ~Environment() = default;
+        ~Environment();
 
         Environment(const Environment &) = delete;
 
@@ -136,8 +348,14 @@ namespace xdg {
 
         Environment& operator=(Environment &&) = delete;
 
-        static Environment &getEnvironment(bool daemonMode = false) {
-            static Environment instance{daemonMode};
+        /**
+         * @brief Get the process Environment, constructing it on the first call.
+         * @param daemonMode Do not use or create user directories.
+         * @param startupMode How the user directories are provisioned, see StartupMode.
+         * @return The Environment. Arguments of calls after the first are ignored.
+         */
+        static Environment &getEnvironment(bool daemonMode = false, StartupMode startupMode = StartupMode::Serial) {
+            static Environment instance{daemonMode, startupMode};
             return instance;
         }
 
@@ -149,11 +367,79 @@ namespace xdg {
 
         [[maybe_unused]] [[nodiscard]] const std::filesystem::path& dataHome() const { return mDataHome; }
 
-        [[maybe_unused]] [[nodiscard]] const std::filesystem::path& appResources() const { return mAppResources; }
+        [[maybe_unused]] [[nodiscard]] const std::filesystem::path& appResources() const {
+            resolveResources();
+            return mAppResources;
+        }
+
+        [[maybe_unused]] [[nodiscard]] const std::filesystem::path& libResources() const {
+            resolveResources();
+            return mLibResources;
+        }
+
+        /**
+         * @brief Get the time spent in each phase of construction, and in deferred resource resolution.
+         */
+        [[maybe_unused]] [[nodiscard]] StartupTimings startupTimings() const {
+            auto timings = mStartupTimings;
+            timings.resources = Clock::duration{mResourcesTime.load(std::memory_order_acquire)};
+            return timings;
+        }
+
+        [[maybe_unused]] [[nodiscard]] const XDGFilePaths& filePaths() const { return mFilePaths; }
+
+        /**
+         * @brief Resolve resources below the XDG base directories without composing absolute paths.
+         */
+        [[maybe_unused]] [[nodiscard]] XDGResolver& resolver() { return mResolver; }
+
+        /**
+         * @brief Search for a relative path on one of the XDG standard locations, remembering the result.
+         * @details As XDGFilePaths::findFilePath(), but both hits and misses are remembered, per XDG name and
+         * relative path, until the resolution TTL expires or the cache is invalidated.
+         * @param name The XDG name
+         * @param relativePath A path relative to an XDG location to search for.
+         * @return A std::tuple<bool,std::filesystem::path>
+         */
+        std::tuple<bool, std::filesystem::path> findFilePath(XDGFilePaths::XDG_Name name,
+                                                             const std::filesystem::path &relativePath);
+
+        /**
+         * @brief Resolve a list of resources concurrently on ysh::ThreadPool::instance(), so later
+         * findFilePath() calls are answered from the cache.
+         * @param resources The XDG names and relative paths.
+         */
+        [[maybe_unused]] void prefetch(const std::vector<std::pair<XDGFilePaths::XDG_Name, std::filesystem::path>> &resources);
+
+        /**
+         * @brief Set how long resolutions are remembered. Zero disables the cache.
+         */
+        [[maybe_unused]] void setResolutionTtl(Clock::duration ttl) {
+            mResolutionTtl.store(ttl.count(), std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Also forget remembered resolutions when an entry in a searched base directory changes.
+         * @details The base directories of each XDG name are watched with inotify(7) from the next resolution
+         * of that name. Only the base directories themselves are watched, a change deeper in a relative path
+         * is still only noticed when the TTL expires. Call before resolving from more than one thread.
+         * @return true if inotify is available.
+         */
+        [[maybe_unused]] bool watchResolutions();
+
+        /**
+         * @brief Forget all remembered resolutions.
+         */
+        void invalidateResolutions();
+
+        [[maybe_unused]] [[nodiscard]] ResolutionStats resolutionStats() const {
+            return {mResolutionHits.load(std::memory_order_relaxed), mResolutionMisses.load(std::memory_order_relaxed),
+                    mResolutionInvalidations.load(std::memory_order_relaxed)};
+        }
 
         template<typename Source>
         [[maybe_unused]] std::filesystem::path appResourcesAppend(Source source) {
-            auto path = mAppResources;
+            auto path = appResources();
             return path.append(source);
         }
 
@@ -175,7 +461,7 @@ namespace xdg {
                 paths.push_back(mConfigHome);
                 paths.back().append(configFile);
             }
-            paths.push_back(mAppResources);
+            paths.push_back(appResources());
             paths.back().append(configFile);
             return paths;
         }
@@ -187,14 +473,71 @@ namespace xdg {
             return paths;
         }
 
+        /**
+         * @brief Get the configuration files to overlay, lowest priority first.
+         * @details The files installed with the application resources, then each XDG_CONFIG_DIRS directory from
+         * least to most important, then the user config home. Files are included whether they exist or not.
+         * @param configFile The configuration file name relative to the application directories.
+         * @return The layer list, for ConfigOverlay::load().
+         */
+        template<typename ConfigFile>
+        [[maybe_unused]] [[nodiscard]] XDGFilePaths::XDG_Path_Set get_configuration_layers(ConfigFile configFile) {
+            std::vector<std::filesystem::path> paths{};
+            paths.push_back(appResources());
+            paths.back().append(configFile);
+            const auto &configDirs = mFilePaths.paths(XDGFilePaths::XDG_CONFIG_DIRS);
+            for (auto dir = configDirs.rbegin(); dir != configDirs.rend(); ++dir) {
+                paths.push_back(*dir);
+                paths.back().append(mAppName).append(configFile);
+            }
+            if (!mConfigHome.empty()) {
+                paths.push_back(mConfigHome);
+                paths.back().append(configFile);
+            }
+            return paths;
+        }
+
+        /**
+         * @brief Get the configuration files to overlay with a command line file on top, lowest priority first.
+         */
+        template<typename ConfigFile, typename Source>
+        [[maybe_unused]] [[nodiscard]] XDGFilePaths::XDG_Path_Set get_configuration_layers(ConfigFile configFile, Source cmdLineOpt) {
+            auto paths = get_configuration_layers(configFile);
+            paths.emplace_back(cmdLineOpt);
+            return paths;
+        }
+
+        /**
+         * @brief Find the first regular file in a path set on which the process holds the requested permissions.
+         * @details Each candidate costs one stat(2) call.
+         * @param pathSet The candidate files in order of preference.
+         * @param permMask a bitwise OR of ysh::Permissions READ, WRITE, EXEC class constants.
+         * @return The file path or std::nullopt.
+         */
         static std::optional<std::filesystem::path> firstExistingFile(const XDGFilePaths::XDG_Path_Set& pathSet,
                                                                       unsigned int permMask = ysh::Permissions::READ) {
             for (const auto& file : pathSet)
-                if (std::filesystem::exists(file) && std::filesystem::is_regular_file(file)) {
-                    ysh::Permissions permissions(file);
-                    if (permissions && permissions.mask(permMask)) {
-                        return file;
-                    }
+                if (ysh::Permissions permissions(file); permissions.regular() && permissions.mask(permMask)) {
+                    return file;
+                }
+            return std::nullopt;
+        }
+
+        /**
+         * @brief Find the first regular file in a path set on which the process holds the requested permissions,
+         * using a PermissionCache.
+         * @details Cached candidates cost no syscall while their parent directories are watched.
+         * @param pathSet The candidate files in order of preference.
+         * @param permMask a bitwise OR of ysh::Permissions READ, WRITE, EXEC class constants.
+         * @param cache The cache to consult.
+         * @return The file path or std::nullopt.
+         */
+        static std::optional<std::filesystem::path> firstExistingFile(const XDGFilePaths::XDG_Path_Set& pathSet,
+                                                                      unsigned int permMask,
+                                                                      ysh::PermissionCache& cache) {
+            for (const auto& file : pathSet)
+                if (auto status = cache.lookup(file); status.regular() && status.mask(permMask)) {
+                    return file;
                 }
             return std::nullopt;
         }
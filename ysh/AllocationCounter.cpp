@@ -0,0 +1,73 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * AllocationCounter.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file AllocationCounter.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "AllocationCounter.h"
+
+namespace {
+    std::atomic<std::size_t> allocationCount{0};
+    std::atomic<std::size_t> deallocationCount{0};
+    std::atomic<std::size_t> byteCount{0};
+
+    void *countedAllocate(std::size_t size, std::size_t alignment = 0) noexcept {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        byteCount.fetch_add(size, std::memory_order_relaxed);
+        if (size == 0)
+            size = 1;
+        if (alignment > alignof(std::max_align_t))
+            return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+        return std::malloc(size);
+    }
+
+    void countedFree(void *ptr) noexcept {
+        if (ptr) {
+            deallocationCount.fetch_add(1, std::memory_order_relaxed);
+            std::free(ptr);
+        }
+    }
+
+    void *throwingAllocate(std::size_t size, std::size_t alignment = 0) {
+        if (auto ptr = countedAllocate(size, alignment); ptr)
+            return ptr;
+        throw std::bad_alloc();
+    }
+}
+
+namespace ysh::allocation {
+
+    Counts counts() {
+        return {allocationCount.load(std::memory_order_relaxed), deallocationCount.load(std::memory_order_relaxed),
+                byteCount.load(std::memory_order_relaxed)};
+    }
+
+} // ysh::allocation
+
+void *operator new(std::size_t size) { return throwingAllocate(size); }
+void *operator new[](std::size_t size) { return throwingAllocate(size); }
+void *operator new(std::size_t size, std::align_val_t al) { return throwingAllocate(size, static_cast<std::size_t>(al)); }
+void *operator new[](std::size_t size, std::align_val_t al) { return throwingAllocate(size, static_cast<std::size_t>(al)); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept { return countedAllocate(size); }
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept { return countedAllocate(size); }
+
+void operator delete(void *ptr) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr) noexcept { countedFree(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { countedFree(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { countedFree(ptr); }
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept { countedFree(ptr); }
@@ -0,0 +1,43 @@
+/*
+ * AllocationCounter.h Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file AllocationCounter.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Heap allocation instrumentation for test and benchmark programs.
+ * @details AllocationCounter.cpp replaces the global operator new and operator delete with versions that
+ * count calls. Only link it into programs that are measuring allocations, the library itself never does.
+ */
+
+#ifndef VE3YSH_UTIL_ALLOCATIONCOUNTER_H
+#define VE3YSH_UTIL_ALLOCATIONCOUNTER_H
+
+#include <cstddef>
+
+namespace ysh::allocation {
+
+    /**
+     * @struct Counts
+     * @brief A snapshot of the process wide allocation counters.
+     */
+    struct Counts {
+        std::size_t allocations{0};     ///< Calls to any form of operator new.
+        std::size_t deallocations{0};   ///< Calls to any form of operator delete with a non-null pointer.
+        std::size_t bytes{0};           ///< Bytes requested from operator new.
+
+        Counts operator-(const Counts &other) const {
+            return {allocations - other.allocations, deallocations - other.deallocations, bytes - other.bytes};
+        }
+    };
+
+    /**
+     * @brief Read the counters.
+     */
+    Counts counts();
+
+} // ysh::allocation
+
+#endif //VE3YSH_UTIL_ALLOCATIONCOUNTER_H
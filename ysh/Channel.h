@@ -0,0 +1,530 @@
+/*
+ * Channel.h Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file Channel.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Bounded lock free channels for handing values between threads.
+ * @details SpscChannel connects one producer thread to one consumer thread. MpmcChannel accepts any number
+ * of each, using a sequence number per slot. Both are fixed size rings with the producer and consumer
+ * positions on separate cache lines. A thread that finds the channel full or empty spins briefly and then
+ * sleeps in std::atomic::wait, which is a futex on Linux. A thread that makes progress only issues a wake
+ * when another thread is asleep.
+ */
+
+#ifndef VE3YSH_UTIL_CHANNEL_H
+#define VE3YSH_UTIL_CHANNEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <thread>
+#include <utility>
+
+namespace ysh {
+
+    namespace channel {
+
+        static constexpr std::size_t CacheLine = 64;
+        static constexpr unsigned SpinCount = 128;      ///< Checks made before a waiting thread sleeps.
+
+        /**
+         * @concept Value
+         * @brief Channel slots are default constructed once and then move assigned.
+         */
+        template<class T>
+        concept Value = std::default_initializable<T> && std::movable<T>;
+
+        /**
+         * @class Signal
+         * @brief Put threads to sleep until a condition might have changed.
+         * @details The waiter registers, then checks its condition again, so either it sees the change or the
+         * notifier sees the registration. notify() is a fence and a load when no thread is waiting.
+         */
+        class alignas(CacheLine) Signal {
+        private:
+            std::atomic<std::uint32_t> mWaiters{0};
+            std::atomic<std::uint32_t> mEpoch{0};
+
+        public:
+            /**
+             * @brief Wake all waiting threads.
+             * @param force Wake threads even if none appear to be waiting, used when closing.
+             */
+            void notify(bool force = false) {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (force || mWaiters.load(std::memory_order_relaxed) != 0) {
+                    mEpoch.fetch_add(1, std::memory_order_release);
+                    mEpoch.notify_all();
+                }
+            }
+
+            /**
+             * @brief Return once ready() is true.
+             */
+            template<class Ready>
+            void wait(Ready ready) {
+                // On a single CPU the other side can only make progress if this thread yields.
+                static const unsigned yieldEvery = std::thread::hardware_concurrency() > 1 ? 16 : 1;
+                for (unsigned spin = 0; spin < SpinCount; ++spin) {
+                    if (ready())
+                        return;
+                    if (spin % yieldEvery == yieldEvery - 1)
+                        std::this_thread::yield();
+                }
+                while (!ready()) {
+                    mWaiters.fetch_add(1, std::memory_order_seq_cst);
+                    auto epoch = mEpoch.load(std::memory_order_acquire);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    if (!ready())
+                        mEpoch.wait(epoch, std::memory_order_acquire);
+                    mWaiters.fetch_sub(1, std::memory_order_relaxed);
+                }
+            }
+        };
+
+        /**
+         * @brief The capacity actually allocated for a requested capacity, a power of two of at least 2.
+         */
+        constexpr std::size_t capacityFor(std::size_t requested) {
+            return std::bit_ceil(std::max<std::size_t>(requested, 2));
+        }
+
+    } // channel
+
+    /**
+     * @class SpscChannel
+     * @brief A bounded channel from one producer thread to one consumer thread.
+     * @details Each side caches the position of the other and only reloads it when the cached value says
+     * the channel is full or empty. A batch moves many values for one publication and at most one wake.
+     * close() may be called from any thread. After close() pushes fail, and pops drain what remains.
+     * @tparam T The value type.
+     */
+    template<channel::Value T>
+    class SpscChannel {
+    private:
+        const std::size_t mMask;
+        const std::unique_ptr<T[]> mSlots;
+
+        alignas(channel::CacheLine) std::atomic<std::size_t> mHead{0};     ///< Next position to pop.
+        std::size_t mTailCache{0};                                          ///< Consumer's copy of mTail.
+
+        alignas(channel::CacheLine) std::atomic<std::size_t> mTail{0};     ///< Next position to push.
+        std::size_t mHeadCache{0};                                          ///< Producer's copy of mHead.
+
+        alignas(channel::CacheLine) std::atomic<bool> mClosed{false};
+        channel::Signal mNotEmpty{};
+        channel::Signal mNotFull{};
+
+        template<class U>
+        bool pushOne(U &&value) {
+            auto tail = mTail.load(std::memory_order_relaxed);
+            if (tail - mHeadCache > mMask) {
+                mHeadCache = mHead.load(std::memory_order_acquire);
+                if (tail - mHeadCache > mMask)
+                    return false;
+            }
+            mSlots[tail & mMask] = std::forward<U>(value);
+            mTail.store(tail + 1, std::memory_order_release);
+            mNotEmpty.notify();
+            return true;
+        }
+
+        [[nodiscard]] bool full() const {
+            return mTail.load(std::memory_order_relaxed) - mHead.load(std::memory_order_acquire) > mMask;
+        }
+
+        [[nodiscard]] bool empty() const {
+            return mTail.load(std::memory_order_acquire) == mHead.load(std::memory_order_relaxed);
+        }
+
+    public:
+        /**
+         * @brief Constructor.
+         * @param capacity The number of values the channel holds, rounded up to a power of two.
+         */
+        explicit SpscChannel(std::size_t capacity)
+                : mMask(channel::capacityFor(capacity) - 1), mSlots(std::make_unique<T[]>(mMask + 1)) {}
+
+        SpscChannel(const SpscChannel &) = delete;
+        SpscChannel &operator=(const SpscChannel &) = delete;
+
+        [[nodiscard]] std::size_t capacity() const { return mMask + 1; }
+
+        /**
+         * @brief The number of values in the channel, exact only when neither side is active.
+         */
+        [[nodiscard]] std::size_t size() const {
+            return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief Push a value if there is room, the value is only moved from on success.
+         */
+        bool tryPush(T &&value) { return !closed() && pushOne(std::move(value)); }
+
+        bool tryPush(const T &value) { return !closed() && pushOne(value); }
+
+        /**
+         * @brief Push a value, waiting for room.
+         * @return false if the channel is closed.
+         */
+        bool push(T value) {
+            while (!tryPush(std::move(value))) {
+                if (closed())
+                    return false;
+                mNotFull.wait([this] { return !full() || closed(); });
+            }
+            return true;
+        }
+
+        /**
+         * @brief Move as many values as there is room for into the channel.
+         * @return The number of values pushed, from the front of values.
+         */
+        std::size_t tryPushBatch(std::span<T> values) {
+            if (closed())
+                return 0;
+            auto tail = mTail.load(std::memory_order_relaxed);
+            if (mMask + 1 - (tail - mHeadCache) < values.size())
+                mHeadCache = mHead.load(std::memory_order_acquire);
+            auto count = std::min(values.size(), mMask + 1 - (tail - mHeadCache));
+            for (std::size_t idx = 0; idx < count; ++idx)
+                mSlots[(tail + idx) & mMask] = std::move(values[idx]);
+            if (count) {
+                mTail.store(tail + count, std::memory_order_release);
+                mNotEmpty.notify();
+            }
+            return count;
+        }
+
+        /**
+         * @brief Move all values into the channel, waiting for room as needed.
+         * @return The number of values pushed, less than values.size() only if the channel is closed.
+         */
+        std::size_t pushBatch(std::span<T> values) {
+            std::size_t pushed = 0;
+            while (pushed < values.size()) {
+                pushed += tryPushBatch(values.subspan(pushed));
+                if (pushed < values.size()) {
+                    if (closed())
+                        break;
+                    mNotFull.wait([this] { return !full() || closed(); });
+                }
+            }
+            return pushed;
+        }
+
+        /**
+         * @brief Pop a value if one is available.
+         */
+        std::optional<T> tryPop() {
+            auto head = mHead.load(std::memory_order_relaxed);
+            if (head == mTailCache) {
+                mTailCache = mTail.load(std::memory_order_acquire);
+                if (head == mTailCache)
+                    return std::nullopt;
+            }
+            std::optional<T> value{std::move(mSlots[head & mMask])};
+            mHead.store(head + 1, std::memory_order_release);
+            mNotFull.notify();
+            return value;
+        }
+
+        /**
+         * @brief Pop a value, waiting for one.
+         * @return The value, or std::nullopt if the channel is closed and empty.
+         */
+        std::optional<T> pop() {
+            for (;;) {
+                if (auto value = tryPop())
+                    return value;
+                if (closed() && empty())
+                    return std::nullopt;
+                mNotEmpty.wait([this] { return !empty() || closed(); });
+            }
+        }
+
+        /**
+         * @brief Move as many values as are available, up to values.size(), out of the channel.
+         * @return The number of values popped into the front of values.
+         */
+        std::size_t tryPopBatch(std::span<T> values) {
+            auto head = mHead.load(std::memory_order_relaxed);
+            if (mTailCache - head < values.size())
+                mTailCache = mTail.load(std::memory_order_acquire);
+            auto count = std::min(values.size(), mTailCache - head);
+            for (std::size_t idx = 0; idx < count; ++idx)
+                values[idx] = std::move(mSlots[(head + idx) & mMask]);
+            if (count) {
+                mHead.store(head + count, std::memory_order_release);
+                mNotFull.notify();
+            }
+            return count;
+        }
+
+        /**
+         * @brief Wait for at least one value and pop as many as are available, up to values.size().
+         * @return The number of values popped, 0 only if the channel is closed and empty.
+         */
+        std::size_t popBatch(std::span<T> values) {
+            for (;;) {
+                if (auto count = tryPopBatch(values); count || values.empty())
+                    return count;
+                if (closed() && empty())
+                    return 0;
+                mNotEmpty.wait([this] { return !empty() || closed(); });
+            }
+        }
+
+        /**
+         * @brief Refuse further pushes and wake all waiting threads.
+         */
+        void close() {
+            mClosed.store(true, std::memory_order_release);
+            mNotEmpty.notify(true);
+            mNotFull.notify(true);
+        }
+
+        [[nodiscard]] bool closed() const { return mClosed.load(std::memory_order_acquire); }
+    };
+
+    /**
+     * @class MpmcChannel
+     * @brief A bounded channel between any number of producer and consumer threads.
+     * @details Dmitry Vyukov's bounded queue. Each slot carries a sequence number that says whether it is
+     * ready to be written or read at a position, so producers and consumers only contend on their own
+     * position counter. Batches claim slots one at a time but publish at most one wake.
+     * @tparam T The value type.
+     */
+    template<channel::Value T>
+    class MpmcChannel {
+    private:
+        struct Slot {
+            std::atomic<std::size_t> sequence{};
+            T value{};
+        };
+
+        const std::size_t mMask;
+        const std::unique_ptr<Slot[]> mSlots;
+
+        alignas(channel::CacheLine) std::atomic<std::size_t> mTail{0};     ///< Next position to push.
+        alignas(channel::CacheLine) std::atomic<std::size_t> mHead{0};     ///< Next position to pop.
+
+        alignas(channel::CacheLine) std::atomic<bool> mClosed{false};
+        channel::Signal mNotEmpty{};
+        channel::Signal mNotFull{};
+
+        template<class U>
+        bool pushOne(U &&value) {
+            auto position = mTail.load(std::memory_order_relaxed);
+            for (;;) {
+                auto &slot = mSlots[position & mMask];
+                auto sequence = slot.sequence.load(std::memory_order_acquire);
+                auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+                if (difference == 0) {
+                    if (mTail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        slot.value = std::forward<U>(value);
+                        slot.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = mTail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool popOne(T &value) {
+            auto position = mHead.load(std::memory_order_relaxed);
+            for (;;) {
+                auto &slot = mSlots[position & mMask];
+                auto sequence = slot.sequence.load(std::memory_order_acquire);
+                auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1);
+                if (difference == 0) {
+                    if (mHead.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        value = std::move(slot.value);
+                        slot.sequence.store(position + mMask + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = mHead.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        [[nodiscard]] bool full() const {
+            auto position = mTail.load(std::memory_order_relaxed);
+            return mSlots[position & mMask].sequence.load(std::memory_order_acquire) < position;
+        }
+
+        [[nodiscard]] bool empty() const {
+            auto position = mHead.load(std::memory_order_relaxed);
+            return mSlots[position & mMask].sequence.load(std::memory_order_acquire) < position + 1;
+        }
+
+    public:
+        /**
+         * @brief Constructor.
+         * @param capacity The number of values the channel holds, rounded up to a power of two.
+         */
+        explicit MpmcChannel(std::size_t capacity)
+                : mMask(channel::capacityFor(capacity) - 1), mSlots(std::make_unique<Slot[]>(mMask + 1)) {
+            for (std::size_t idx = 0; idx <= mMask; ++idx)
+                mSlots[idx].sequence.store(idx, std::memory_order_relaxed);
+        }
+
+        MpmcChannel(const MpmcChannel &) = delete;
+        MpmcChannel &operator=(const MpmcChannel &) = delete;
+
+        [[nodiscard]] std::size_t capacity() const { return mMask + 1; }
+
+        /**
+         * @brief The number of values in the channel, approximate while either side is active.
+         */
+        [[nodiscard]] std::size_t size() const {
+            auto head = mHead.load(std::memory_order_acquire);
+            auto tail = mTail.load(std::memory_order_acquire);
+            return tail > head ? std::min(tail - head, mMask + 1) : 0;
+        }
+
+        /**
+         * @brief Push a value if there is room, the value is only moved from on success.
+         */
+        bool tryPush(T &&value) {
+            if (closed() || !pushOne(std::move(value)))
+                return false;
+            mNotEmpty.notify();
+            return true;
+        }
+
+        bool tryPush(const T &value) {
+            if (closed() || !pushOne(value))
+                return false;
+            mNotEmpty.notify();
+            return true;
+        }
+
+        /**
+         * @brief Push a value, waiting for room.
+         * @return false if the channel is closed.
+         */
+        bool push(T value) {
+            while (!tryPush(std::move(value))) {
+                if (closed())
+                    return false;
+                mNotFull.wait([this] { return !full() || closed(); });
+            }
+            return true;
+        }
+
+        /**
+         * @brief Move as many values as there is room for into the channel.
+         * @return The number of values pushed, from the front of values.
+         */
+        std::size_t tryPushBatch(std::span<T> values) {
+            if (closed())
+                return 0;
+            std::size_t count = 0;
+            while (count < values.size() && pushOne(std::move(values[count])))
+                ++count;
+            if (count)
+                mNotEmpty.notify();
+            return count;
+        }
+
+        /**
+         * @brief Move all values into the channel, waiting for room as needed.
+         * @return The number of values pushed, less than values.size() only if the channel is closed.
+         */
+        std::size_t pushBatch(std::span<T> values) {
+            std::size_t pushed = 0;
+            while (pushed < values.size()) {
+                pushed += tryPushBatch(values.subspan(pushed));
+                if (pushed < values.size()) {
+                    if (closed())
+                        break;
+                    mNotFull.wait([this] { return !full() || closed(); });
+                }
+            }
+            return pushed;
+        }
+
+        /**
+         * @brief Pop a value if one is available.
+         */
+        std::optional<T> tryPop() {
+            std::optional<T> value{std::in_place};
+            if (!popOne(*value))
+                return std::nullopt;
+            mNotFull.notify();
+            return value;
+        }
+
+        /**
+         * @brief Pop a value, waiting for one.
+         * @return The value, or std::nullopt if the channel is closed and empty.
+         */
+        std::optional<T> pop() {
+            for (;;) {
+                if (auto value = tryPop())
+                    return value;
+                if (closed() && empty())
+                    return std::nullopt;
+                mNotEmpty.wait([this] { return !empty() || closed(); });
+            }
+        }
+
+        /**
+         * @brief Move as many values as are available, up to values.size(), out of the channel.
+         * @return The number of values popped into the front of values.
+         */
+        std::size_t tryPopBatch(std::span<T> values) {
+            std::size_t count = 0;
+            while (count < values.size() && popOne(values[count]))
+                ++count;
+            if (count)
+                mNotFull.notify();
+            return count;
+        }
+
+        /**
+         * @brief Wait for at least one value and pop as many as are available, up to values.size().
+         * @return The number of values popped, 0 only if the channel is closed and empty.
+         */
+        std::size_t popBatch(std::span<T> values) {
+            for (;;) {
+                if (auto count = tryPopBatch(values); count || values.empty())
+                    return count;
+                if (closed() && empty())
+                    return 0;
+                mNotEmpty.wait([this] { return !empty() || closed(); });
+            }
+        }
+
+        /**
+         * @brief Refuse further pushes and wake all waiting threads.
+         */
+        void close() {
+            mClosed.store(true, std::memory_order_release);
+            mNotEmpty.notify(true);
+            mNotFull.notify(true);
+        }
+
+        [[nodiscard]] bool closed() const { return mClosed.load(std::memory_order_acquire); }
+    };
+
+} // ysh
+
+#endif //VE3YSH_UTIL_CHANNEL_H
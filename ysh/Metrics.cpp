@@ -0,0 +1,122 @@
+/*
+ * Metrics.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file Metrics.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief
+ * @details
+ */
+
+#include <algorithm>
+#include "Metrics.h"
+
+namespace ysh {
+
+    std::size_t metrics::shard() {
+        static std::atomic<std::size_t> next{0};
+        thread_local std::size_t shard = next.fetch_add(1, std::memory_order_relaxed) % Shards;
+        return shard;
+    }
+
+    std::uint64_t HistogramSnapshot::quantile(double q) const {
+        if (count == 0)
+            return 0;
+        auto rank = static_cast<std::uint64_t>(std::clamp(q, 0.0, 1.0) * static_cast<double>(count - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (std::size_t bucket = 0; bucket < buckets.size(); ++bucket) {
+            seen += buckets[bucket];
+            if (seen >= rank)
+                return std::min(Histogram::upperBound(bucket), max);
+        }
+        return max;
+    }
+
+    HistogramSnapshot Histogram::snapshot() const {
+        HistogramSnapshot snapshot{};
+        snapshot.buckets.resize(BucketCount);
+        for (std::size_t idx = 0; idx < metrics::Shards; ++idx) {
+            const auto &shard = mShards[idx];
+            snapshot.count += shard.count.load(std::memory_order_relaxed);
+            snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+            snapshot.max = std::max(snapshot.max, shard.max.load(std::memory_order_relaxed));
+            for (std::size_t bucket = 0; bucket < BucketCount; ++bucket)
+                snapshot.buckets[bucket] += shard.buckets[bucket].load(std::memory_order_relaxed);
+        }
+        // Recover a max lost to a racing store, to within the width of the highest occupied bucket.
+        for (auto bucket = BucketCount; bucket-- > 0;)
+            if (snapshot.buckets[bucket]) {
+                snapshot.max = std::max(snapshot.max, lowerBound(bucket));
+                break;
+            }
+        return snapshot;
+    }
+
+    MetricsRegistry &MetricsRegistry::instance() {
+        static MetricsRegistry registry{};
+        return registry;
+    }
+
+    namespace {
+        template<class Metric>
+        Metric &findOrAdd(std::map<std::string, std::unique_ptr<Metric>, std::less<>> &map, std::string_view name) {
+            if (auto found = map.find(name); found != map.end())
+                return *found->second;
+            return *map.emplace(std::string{name}, std::make_unique<Metric>()).first->second;
+        }
+    }
+
+    Counter &MetricsRegistry::counter(std::string_view name) {
+        return mMetrics.with([name](Metrics &metrics) -> Counter & { return findOrAdd(metrics.counters, name); });
+    }
+
+    Gauge &MetricsRegistry::gauge(std::string_view name) {
+        return mMetrics.with([name](Metrics &metrics) -> Gauge & { return findOrAdd(metrics.gauges, name); });
+    }
+
+    Histogram &MetricsRegistry::histogram(std::string_view name) {
+        return mMetrics.with([name](Metrics &metrics) -> Histogram & { return findOrAdd(metrics.histograms, name); });
+    }
+
+    MetricsSnapshot MetricsRegistry::snapshot() const {
+        return mMetrics.with([](const Metrics &metrics) {
+            MetricsSnapshot snapshot{};
+            for (const auto &[name, counter] : metrics.counters)
+                snapshot.counters.emplace_back(name, counter->value());
+            for (const auto &[name, gauge] : metrics.gauges)
+                snapshot.gauges.emplace_back(name, gauge->value());
+            for (const auto &[name, histogram] : metrics.histograms)
+                snapshot.histograms.emplace_back(name, histogram->snapshot());
+            return snapshot;
+        });
+    }
+
+    MetricsExporter::MetricsExporter(const MetricsRegistry &registry, std::chrono::milliseconds period,
+                                     Callback callback)
+            : mRegistry(registry), mPeriod(period), mCallback(std::move(callback)) {
+        mThread = std::thread{&MetricsExporter::run, this};
+    }
+
+    MetricsExporter::~MetricsExporter() {
+        {
+            std::lock_guard<std::mutex> lock{mMutex};
+            mStop = true;
+        }
+        mStopSignal.notify_all();
+        if (mThread.joinable())
+            mThread.join();
+    }
+
+    void MetricsExporter::run() {
+        std::unique_lock<std::mutex> lock{mMutex};
+        while (!mStopSignal.wait_for(lock, mPeriod, [this] { return mStop; })) {
+            lock.unlock();
+            mCallback(mRegistry.snapshot());
+            lock.lock();
+        }
+    }
+
+} // ysh
@@ -0,0 +1,282 @@
+/*
+ * Metrics.h Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file Metrics.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief A process wide registry of counters, gauges and histograms.
+ * @details Metrics are registered by name once, usually into a function local static reference, and updated
+ * on the hot path with a single relaxed atomic operation. Counters and histograms are sharded per thread so
+ * updates from different threads do not share cache lines. A snapshot sums the shards.
+ */
+
+#ifndef VE3YSH_UTIL_METRICS_H
+#define VE3YSH_UTIL_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <MutexGuarded.h>
+
+namespace ysh {
+
+    namespace metrics {
+
+        static constexpr std::size_t Shards = 8;            ///< Update shards per counter and histogram.
+        static constexpr std::size_t CacheLine = 64;
+
+        /**
+         * @brief The shard the calling thread updates. Threads are assigned shards round robin.
+         */
+        std::size_t shard();
+
+        /**
+         * @struct alignas(CacheLine) Cell
+         * @brief An atomic value alone on its cache line.
+         */
+        struct alignas(CacheLine) Cell {
+            std::atomic<std::uint64_t> value{0};
+        };
+
+    } // metrics
+
+    /**
+     * @class Counter
+     * @brief A monotonically increasing count.
+     */
+    class Counter {
+    private:
+        std::array<metrics::Cell, metrics::Shards> mCells{};
+
+    public:
+        void add(std::uint64_t n = 1) {
+            mCells[metrics::shard()].value.fetch_add(n, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] std::uint64_t value() const {
+            std::uint64_t sum = 0;
+            for (const auto &cell : mCells)
+                sum += cell.value.load(std::memory_order_relaxed);
+            return sum;
+        }
+    };
+
+    /**
+     * @class Gauge
+     * @brief A value that is set, or moved up and down.
+     */
+    class Gauge {
+    private:
+        alignas(metrics::CacheLine) std::atomic<std::int64_t> mValue{0};
+
+    public:
+        void set(std::int64_t value) { mValue.store(value, std::memory_order_relaxed); }
+
+        void add(std::int64_t n) { mValue.fetch_add(n, std::memory_order_relaxed); }
+
+        [[nodiscard]] std::int64_t value() const { return mValue.load(std::memory_order_relaxed); }
+    };
+
+    /**
+     * @struct HistogramSnapshot
+     * @brief The summed state of a Histogram.
+     */
+    struct HistogramSnapshot {
+        std::uint64_t count{0};
+        std::uint64_t sum{0};
+        std::uint64_t max{0};
+        std::vector<std::uint64_t> buckets{};
+
+        [[nodiscard]] double mean() const {
+            return count ? static_cast<double>(sum) / static_cast<double>(count) : 0.0;
+        }
+
+        /**
+         * @brief Estimate a quantile.
+         * @param q The quantile in [0, 1].
+         * @return The upper bound of the bucket holding the quantile, never more than max.
+         */
+        [[nodiscard]] std::uint64_t quantile(double q) const;
+    };
+
+    /**
+     * @class Histogram
+     * @brief A distribution of non-negative values recorded into fixed log-linear buckets.
+     * @details Values below SubBuckets have a bucket each. Above that every power of two is split into
+     * SubBuckets equal buckets, so a bucket is never wider than 1/SubBuckets of its lower bound. Recording a
+     * value is three relaxed atomic adds on the calling thread's shard, and a relaxed store when it raises the
+     * shard's max, so it is wait-free. Threads sharing a shard can overwrite each other's max, the snapshot
+     * raises the merged max to the lower bound of the highest occupied bucket, so a lost max is off by less
+     * than that bucket's width.
+     */
+    class Histogram {
+    public:
+        static constexpr unsigned SubBucketBits = 3;
+        static constexpr std::size_t SubBuckets = 1u << SubBucketBits;
+        static constexpr std::size_t BucketCount = (64 - SubBucketBits + 1) * SubBuckets;
+
+        /**
+         * @brief The bucket a value is recorded in.
+         */
+        static constexpr std::size_t bucketOf(std::uint64_t value) {
+            if (value < SubBuckets)
+                return static_cast<std::size_t>(value);
+            auto magnitude = static_cast<unsigned>(std::bit_width(value)) - 1;
+            auto shift = magnitude - SubBucketBits;
+            return (shift + 1) * SubBuckets + static_cast<std::size_t>((value >> shift) & (SubBuckets - 1));
+        }
+
+        /**
+         * @brief The smallest value recorded in a bucket.
+         */
+        static constexpr std::uint64_t lowerBound(std::size_t bucket) {
+            if (bucket < SubBuckets)
+                return bucket;
+            auto shift = static_cast<unsigned>(bucket / SubBuckets - 1);
+            return (SubBuckets + bucket % SubBuckets) << shift;
+        }
+
+        /**
+         * @brief The largest value recorded in a bucket.
+         */
+        static constexpr std::uint64_t upperBound(std::size_t bucket) {
+            return bucket + 1 < BucketCount ? lowerBound(bucket + 1) - 1 : UINT64_MAX;
+        }
+
+    private:
+        struct alignas(metrics::CacheLine) Shard {
+            std::atomic<std::uint64_t> count{0};
+            std::atomic<std::uint64_t> sum{0};
+            std::atomic<std::uint64_t> max{0};
+            std::array<std::atomic<std::uint64_t>, BucketCount> buckets{};
+        };
+
+        std::unique_ptr<Shard[]> mShards{std::make_unique<Shard[]>(metrics::Shards)};
+
+    public:
+        void record(std::uint64_t value) {
+            auto &shard = mShards[metrics::shard()];
+            shard.buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+            shard.count.fetch_add(1, std::memory_order_relaxed);
+            shard.sum.fetch_add(value, std::memory_order_relaxed);
+            if (value > shard.max.load(std::memory_order_relaxed))
+                shard.max.store(value, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] HistogramSnapshot snapshot() const;
+    };
+
+    /**
+     * @class ScopedTimer
+     * @brief Record the lifetime of the timer in nanoseconds into a Histogram.
+     */
+    class ScopedTimer {
+    private:
+        Histogram &mHistogram;
+        std::chrono::steady_clock::time_point mStart{std::chrono::steady_clock::now()};
+
+    public:
+        explicit ScopedTimer(Histogram &histogram) : mHistogram(histogram) {}
+
+        ScopedTimer(const ScopedTimer &) = delete;
+        ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+        ~ScopedTimer() {
+            auto elapsed = std::chrono::steady_clock::now() - mStart;
+            mHistogram.record(static_cast<std::uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+    };
+
+    /**
+     * @struct MetricsSnapshot
+     * @brief The value of every registered metric at one time, ordered by name.
+     */
+    struct MetricsSnapshot {
+        std::vector<std::pair<std::string, std::uint64_t>> counters{};
+        std::vector<std::pair<std::string, std::int64_t>> gauges{};
+        std::vector<std::pair<std::string, HistogramSnapshot>> histograms{};
+    };
+
+    /**
+     * @class MetricsRegistry
+     * @brief Named metrics.
+     * @details Registration takes a lock and returns a reference that stays valid for the life of the
+     * registry, registering an existing name returns the existing metric. Names are written as InfluxDB tag
+     * values, escaped by writeMetrics().
+     */
+    class MetricsRegistry {
+    private:
+        struct Metrics {
+            std::map<std::string, std::unique_ptr<Counter>, std::less<>> counters{};
+            std::map<std::string, std::unique_ptr<Gauge>, std::less<>> gauges{};
+            std::map<std::string, std::unique_ptr<Histogram>, std::less<>> histograms{};
+        };
+
+        MutexGuarded<Metrics> mMetrics{};
+
+    public:
+        MetricsRegistry() = default;
+
+        /**
+         * @brief The process wide registry the library instruments itself into.
+         */
+        static MetricsRegistry &instance();
+
+        Counter &counter(std::string_view name);
+
+        Gauge &gauge(std::string_view name);
+
+        Histogram &histogram(std::string_view name);
+
+        [[nodiscard]] MetricsSnapshot snapshot() const;
+    };
+
+    /**
+     * @class MetricsExporter
+     * @brief Periodically snapshot a registry on a background thread and pass the snapshot to a callback.
+     * @details The callback runs on the exporter thread. Destroying the exporter stops the thread after the
+     * callback in progress, if any, returns.
+     */
+    class MetricsExporter {
+    public:
+        using Callback = std::function<void(const MetricsSnapshot &)>;
+
+    private:
+        const MetricsRegistry &mRegistry;
+        std::chrono::milliseconds mPeriod;
+        Callback mCallback;
+        std::mutex mMutex{};
+        std::condition_variable mStopSignal{};
+        bool mStop{false};
+        std::thread mThread{};
+
+        void run();
+
+    public:
+        MetricsExporter(const MetricsRegistry &registry, std::chrono::milliseconds period, Callback callback);
+
+        MetricsExporter(const MetricsExporter &) = delete;
+        MetricsExporter &operator=(const MetricsExporter &) = delete;
+
+        ~MetricsExporter();
+    };
+
+} // ysh
+
+#endif //VE3YSH_UTIL_METRICS_H
@@ -0,0 +1,261 @@
+/*
+ * ObjectPool.h Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file ObjectPool.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief Recycle objects that are repeatedly created, used briefly and destroyed.
+ * @details ObjectPool<T>::instance() hands out Pooled<T> handles. Releasing a handle clears the object, which
+ * for strings and containers keeps the capacity, and keeps it for the next acquire. Each thread caches a
+ * few released objects. The cache overflows to, and refills from, a lock free stack shared by all threads,
+ * so a steady state workload stops allocating once the pool holds its peak demand.
+ */
+
+#ifndef VE3YSH_UTIL_OBJECTPOOL_H
+#define VE3YSH_UTIL_OBJECTPOOL_H
+
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <Metrics.h>
+
+namespace ysh {
+
+    namespace objectpool {
+
+        static constexpr std::size_t CacheSize = 32;            ///< Released objects each thread keeps.
+        static constexpr std::size_t RetainLimit = 1u << 20;    ///< Largest capacity kept on release.
+
+        template<class T>
+        struct Node {
+            T value{};
+            std::atomic<Node *> next{nullptr};
+        };
+
+        /**
+         * @brief Return an object to its empty state, keeping storage up to RetainLimit.
+         */
+        template<class T>
+        void reset(T &value) {
+            if constexpr (requires { value.clear(); })
+                value.clear();
+            if constexpr (requires { value.capacity(); value.shrink_to_fit(); })
+                if (value.capacity() > RetainLimit)
+                    value.shrink_to_fit();
+        }
+
+    } // objectpool
+
+    /**
+     * @struct ObjectPoolStats
+     * @brief Counts kept by an ObjectPool.
+     */
+    struct ObjectPoolStats {
+        std::uint64_t acquires{0};      ///< Objects handed out.
+        std::uint64_t hits{0};          ///< Acquires satisfied by a released object.
+        std::uint64_t highWater{0};     ///< Objects created. Nothing is freed, so this is the peak pool size.
+        std::uint64_t inUse{0};         ///< Objects currently held by handles.
+
+        [[nodiscard]] double hitRate() const {
+            return acquires ? static_cast<double>(hits) / static_cast<double>(acquires) : 0.0;
+        }
+    };
+
+    template<std::default_initializable T>
+    class ObjectPool;
+
+    /**
+     * @class Pooled
+     * @brief A move only handle to an object from ObjectPool<T>, returned to the pool on destruction.
+     */
+    template<std::default_initializable T>
+    class Pooled {
+    private:
+        objectpool::Node<T> *mNode{nullptr};
+
+        friend class ObjectPool<T>;
+
+        explicit Pooled(objectpool::Node<T> *node) : mNode(node) {}
+
+    public:
+        Pooled() = default;
+
+        Pooled(const Pooled &) = delete;
+        Pooled &operator=(const Pooled &) = delete;
+
+        Pooled(Pooled &&other) noexcept : mNode(std::exchange(other.mNode, nullptr)) {}
+
+        Pooled &operator=(Pooled &&other) noexcept {
+            if (this != &other) {
+                reset();
+                mNode = std::exchange(other.mNode, nullptr);
+            }
+            return *this;
+        }
+
+        ~Pooled() { reset(); }
+
+        /**
+         * @brief Return the object to the pool now.
+         */
+        void reset() {
+            if (mNode)
+                ObjectPool<T>::instance().release(std::exchange(mNode, nullptr));
+        }
+
+        T &operator*() const { return mNode->value; }
+
+        T *operator->() const { return &mNode->value; }
+
+        T *get() const { return mNode ? &mNode->value : nullptr; }
+
+        explicit operator bool() const { return mNode != nullptr; }
+    };
+
+    /**
+     * @class ObjectPool
+     * @brief The process wide pool of one type.
+     * @details The shared overflow stack is a Treiber stack whose head packs a 48 bit pointer with a 16 bit
+     * version to defeat ABA. Nodes are never freed, which is what makes reading the next pointer of a node
+     * another thread has just popped safe. The pool itself is never destroyed, so handles and thread caches
+     * may outlive static destruction order.
+     * @tparam T The object type, cleared with clear() on release if it has one.
+     */
+    template<std::default_initializable T>
+    class ObjectPool {
+    private:
+        using Node = objectpool::Node<T>;
+
+        static_assert(sizeof(void *) == 8, "The overflow stack packs pointers into 48 bits.");
+        static constexpr unsigned PointerBits = 48;
+        static constexpr std::uint64_t PointerMask = (std::uint64_t{1} << PointerBits) - 1;
+
+        /**
+         * @struct Cache
+         * @brief The released objects kept by one thread, given to the shared stack when the thread exits.
+         */
+        struct Cache {
+            std::array<Node *, objectpool::CacheSize> nodes{};
+            std::size_t count{0};
+
+            ~Cache() {
+                if (count)
+                    ObjectPool::instance().pushChain(nodes.data(), count);
+            }
+        };
+
+        alignas(metrics::CacheLine) std::atomic<std::uint64_t> mHead{0};
+        Counter mAcquires{};
+        Counter mHits{};
+        Counter mReleases{};
+        Counter mCreated{};
+
+        ObjectPool() = default;
+
+        static Cache &cache() {
+            thread_local Cache threadCache{};
+            return threadCache;
+        }
+
+        static Node *pointer(std::uint64_t head) { return reinterpret_cast<Node *>(head & PointerMask); }
+
+        static std::uint64_t pack(Node *node, std::uint64_t head) {
+            return (reinterpret_cast<std::uint64_t>(node) & PointerMask)
+                   | (((head >> PointerBits) + 1) << PointerBits);
+        }
+
+        /**
+         * @brief Push nodes onto the shared stack with one successful compare and swap.
+         */
+        void pushChain(Node *const *nodes, std::size_t count) {
+            for (std::size_t idx = 0; idx + 1 < count; ++idx)
+                nodes[idx]->next.store(nodes[idx + 1], std::memory_order_relaxed);
+            auto head = mHead.load(std::memory_order_relaxed);
+            do {
+                nodes[count - 1]->next.store(pointer(head), std::memory_order_relaxed);
+            } while (!mHead.compare_exchange_weak(head, pack(nodes[0], head), std::memory_order_release,
+                                                  std::memory_order_relaxed));
+        }
+
+        Node *pop() {
+            auto head = mHead.load(std::memory_order_acquire);
+            while (auto node = pointer(head)) {
+                auto next = node->next.load(std::memory_order_relaxed);
+                if (mHead.compare_exchange_weak(head, pack(next, head), std::memory_order_acquire,
+                                                std::memory_order_acquire))
+                    return node;
+            }
+            return nullptr;
+        }
+
+        void release(Node *node) {
+            objectpool::reset(node->value);
+            mReleases.add();
+            auto &threadCache = cache();
+            if (threadCache.count == threadCache.nodes.size()) {
+                // Keep the most recently released half, which is most likely still in this CPU's cache.
+                auto half = threadCache.nodes.size() / 2;
+                pushChain(threadCache.nodes.data(), half);
+                std::move(threadCache.nodes.begin() + static_cast<std::ptrdiff_t>(half), threadCache.nodes.end(),
+                          threadCache.nodes.begin());
+                threadCache.count -= half;
+            }
+            threadCache.nodes[threadCache.count++] = node;
+        }
+
+        friend class Pooled<T>;
+
+    public:
+        ObjectPool(const ObjectPool &) = delete;
+        ObjectPool &operator=(const ObjectPool &) = delete;
+
+        static ObjectPool &instance() {
+            static auto *pool = new ObjectPool{};
+            return *pool;
+        }
+
+        /**
+         * @brief Get an object, reusing a released one if possible.
+         * @return A handle to an object in its cleared state.
+         */
+        Pooled<T> acquire() {
+            mAcquires.add();
+            auto &threadCache = cache();
+            Node *node = nullptr;
+            if (threadCache.count)
+                node = threadCache.nodes[--threadCache.count];
+            else
+                node = pop();
+            if (node) {
+                mHits.add();
+            } else {
+                node = new Node{};
+                mCreated.add();
+            }
+            return Pooled<T>{node};
+        }
+
+        [[nodiscard]] ObjectPoolStats stats() const {
+            // Releases first, so a release racing this call cannot make inUse negative.
+            auto releases = mReleases.value();
+            auto acquires = mAcquires.value();
+            return ObjectPoolStats{acquires, mHits.value(), mCreated.value(), acquires - releases};
+        }
+    };
+
+    /**
+     * @brief A string that keeps its capacity between uses.
+     */
+    using PooledBuffer = Pooled<std::string>;
+
+    inline PooledBuffer acquireBuffer() { return ObjectPool<std::string>::instance().acquire(); }
+
+} // ysh
+
+#endif //VE3YSH_UTIL_OBJECTPOOL_H
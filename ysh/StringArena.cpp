@@ -0,0 +1,44 @@
+//
+// Created by richard on 19/10/26.
+//
+
+/*
+ * StringArena.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file StringArena.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ */
+
+#include <algorithm>
+#include "StringArena.h"
+
+namespace ysh {
+
+    char *StringArena::grow(std::size_t size) {
+        // Blocks past the current one are left over from before a release, reuse the first that is big enough.
+        auto next = mBlocks.empty() ? 0 : mBlock + 1;
+        while (next < mBlocks.size() && mBlocks[next].size < size)
+            ++next;
+
+        if (next == mBlocks.size()) {
+            auto blockSize = std::max(size, mBlocks.empty() ? mBlockSize : mBlocks.back().size * 2);
+            mBlocks.push_back(Block{std::make_unique<char[]>(blockSize), blockSize});
+        }
+
+        mBlock = next;
+        mOffset = size;
+        return mBlocks[mBlock].data.get();
+    }
+
+    std::size_t StringArena::capacity() const {
+        std::size_t total{0};
+        for (const auto &block : mBlocks)
+            total += block.size;
+        return total;
+    }
+
+} // ysh
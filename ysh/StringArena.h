@@ -0,0 +1,154 @@
+/*
+ * StringArena.h Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file StringArena.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief A thread local bump allocator for building short lived strings.
+ * @details
+ */
+
+#ifndef VE3YSH_UTIL_STRINGARENA_H
+#define VE3YSH_UTIL_STRINGARENA_H
+
+#include <memory>
+#include <string_view>
+#include <vector>
+#include <StringComposite.h>
+
+namespace ysh {
+
+    /**
+     * @class StringArena
+     * @brief A bump allocator handing out character storage from a list of blocks.
+     * @details Storage is only reclaimed by release() or reset(), which rewind the arena without freeing the
+     * blocks, so once an arena has grown to the working size of a loop iteration it does no further heap
+     * allocation. Use ArenaScope to rewind at the end of a request or iteration. An arena is not thread safe,
+     * local() provides one per thread.
+     */
+    class StringArena {
+    public:
+        static constexpr std::size_t DefaultBlockSize = 4096;
+
+        /**
+         * @struct Mark
+         * @brief A position in the arena that may be released back to.
+         */
+        struct Mark {
+            std::size_t block{0};
+            std::size_t offset{0};
+        };
+
+    private:
+        struct Block {
+            std::unique_ptr<char[]> data{};
+            std::size_t size{0};
+        };
+
+        std::vector<Block> mBlocks{};
+        std::size_t mBlockSize{DefaultBlockSize};
+        std::size_t mBlock{0};      ///< The block currently allocated from.
+        std::size_t mOffset{0};     ///< The first free character in the current block.
+
+        /**
+         * @brief Move to the first following block with room for size characters, adding one if required.
+         */
+        char *grow(std::size_t size);
+
+    public:
+        StringArena() = default;
+
+        explicit StringArena(std::size_t blockSize) : mBlockSize(blockSize) {}
+
+        StringArena(const StringArena &) = delete;
+        StringArena &operator=(const StringArena &) = delete;
+        StringArena(StringArena &&) = default;
+        StringArena &operator=(StringArena &&) = default;
+
+        /**
+         * @brief The arena belonging to the calling thread.
+         */
+        static StringArena &local() {
+            thread_local StringArena arena{};
+            return arena;
+        }
+
+        /**
+         * @brief Allocate uninitialized character storage.
+         * @param size The number of characters.
+         * @return A pointer to the storage, valid until the arena is released past it.
+         */
+        char *allocate(std::size_t size) {
+            if (mBlock < mBlocks.size() && mBlocks[mBlock].size - mOffset >= size) {
+                auto ptr = mBlocks[mBlock].data.get() + mOffset;
+                mOffset += size;
+                return ptr;
+            }
+            return grow(size);
+        }
+
+        /**
+         * @brief Composite a pack of arguments into arena storage.
+         * @details The storage is sized from composite::bound() and the unused tail is returned to the arena.
+         * A null character follows the content, so data() of the result may be used as a C string.
+         * @return A view of the composited characters, valid until the arena is released past it.
+         */
+        template<typename... Args>
+        requires (composite::Direct<Args> && ...)
+        std::string_view composite(const Args &... args) {
+            auto bound = (composite::bound(args) + ... + 0) + 1;
+            auto first = allocate(bound);
+            auto end = composite::writeBounded(first, first + bound - 1, args...);
+            *end = '\0';
+            mOffset -= static_cast<std::size_t>(first + bound - (end + 1));
+            return {first, static_cast<std::size_t>(end - first)};
+        }
+
+        [[nodiscard]] Mark mark() const { return {mBlock, mOffset}; }
+
+        /**
+         * @brief Release all storage allocated after a Mark.
+         */
+        void release(Mark mark) {
+            mBlock = mark.block;
+            mOffset = mark.offset;
+        }
+
+        /**
+         * @brief Release all storage, keeping the blocks for reuse.
+         */
+        void reset() { release(Mark{}); }
+
+        /**
+         * @brief The total characters of storage held by the arena.
+         */
+        [[nodiscard]] std::size_t capacity() const;
+    };
+
+    /**
+     * @class ArenaScope
+     * @brief Release a StringArena back to the position it had when the scope was entered.
+     * @details Scopes nest. Views obtained inside the scope must not be used after it ends.
+     */
+    class ArenaScope {
+    private:
+        StringArena &mArena;
+        StringArena::Mark mMark;
+
+    public:
+        explicit ArenaScope(StringArena &arena = StringArena::local()) : mArena(arena), mMark(arena.mark()) {}
+
+        ~ArenaScope() { mArena.release(mMark); }
+
+        ArenaScope(const ArenaScope &) = delete;
+        ArenaScope &operator=(const ArenaScope &) = delete;
+
+        [[nodiscard]] StringArena &arena() { return mArena; }
+    };
+
+} // ysh
+
+#endif //VE3YSH_UTIL_STRINGARENA_H
@@ -0,0 +1,145 @@
+/*
+ * ThreadPool.cpp Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file ThreadPool.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief
+ * @details
+ */
+
+#include <sched.h>
+#include "ThreadPool.h"
+
+namespace ysh {
+
+    namespace {
+        static constexpr std::size_t InjectionCapacity = 4096;
+        static constexpr unsigned IdleSpins = 64;       ///< Searches made before an idle worker parks.
+
+        thread_local const ThreadPool *currentPool = nullptr;
+        thread_local std::size_t currentWorker = 0;
+
+        /**
+         * @brief A per thread xorshift generator used to pick steal victims.
+         */
+        std::uint32_t nextRandom() {
+            thread_local std::uint32_t state = static_cast<std::uint32_t>(
+                    std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1u;
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+
+        void execute(pool::Task *task) noexcept {
+            task->body();
+            delete task;
+        }
+    }
+
+    std::size_t ThreadPool::affinityCount() {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0)
+            if (auto count = CPU_COUNT(&cpus); count > 0)
+                return static_cast<std::size_t>(count);
+        return std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    ThreadPool &ThreadPool::instance() {
+        static ThreadPool threadPool{};
+        return threadPool;
+    }
+
+    ThreadPool::ThreadPool(std::size_t threads) : mInjection(InjectionCapacity) {
+        if (threads == 0)
+            threads = affinityCount();
+        // All deques exist before any worker can try to steal from them.
+        for (std::size_t idx = 0; idx < threads; ++idx)
+            mWorkers.push_back(std::make_unique<Worker>());
+        for (std::size_t idx = 0; idx < threads; ++idx)
+            mWorkers[idx]->thread = std::thread{&ThreadPool::run, this, idx};
+    }
+
+    ThreadPool::~ThreadPool() {
+        mStopping.store(true, std::memory_order_release);
+        mEpoch.fetch_add(1, std::memory_order_release);
+        mEpoch.notify_all();
+        for (auto &worker : mWorkers)
+            worker->thread.join();
+    }
+
+    std::size_t ThreadPool::self() const {
+        return currentPool == this ? currentWorker : mWorkers.size();
+    }
+
+    void ThreadPool::schedule(pool::Task *task) {
+        if (auto worker = self(); worker < mWorkers.size())
+            mWorkers[worker]->deque.push(task);
+        else
+            mInjection.push(task);
+        wake();
+    }
+
+    void ThreadPool::wake() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mSleepers.load(std::memory_order_relaxed) != 0) {
+            mEpoch.fetch_add(1, std::memory_order_release);
+            mEpoch.notify_one();
+        }
+    }
+
+    pool::Task *ThreadPool::find(std::size_t self) {
+        if (auto task = mWorkers[self]->deque.take())
+            return task;
+        if (auto task = mInjection.tryPop())
+            return *task;
+        auto count = mWorkers.size();
+        auto start = static_cast<std::size_t>(nextRandom()) % count;
+        for (std::size_t offset = 0; offset < count; ++offset) {
+            auto victim = (start + offset) % count;
+            if (victim == self)
+                continue;
+            if (auto task = mWorkers[victim]->deque.steal())
+                return task;
+        }
+        return nullptr;
+    }
+
+    void ThreadPool::run(std::size_t self) {
+        currentPool = this;
+        currentWorker = self;
+        for (;;) {
+            pool::Task *task = nullptr;
+            for (unsigned spin = 0; spin < IdleSpins && task == nullptr; ++spin) {
+                task = find(self);
+                if (task == nullptr && spin > 0)
+                    std::this_thread::yield();
+            }
+            if (task) {
+                execute(task);
+                continue;
+            }
+
+            // Park. Either the search below sees work scheduled after registering, or wake() sees the sleeper.
+            mSleepers.fetch_add(1, std::memory_order_seq_cst);
+            auto epoch = mEpoch.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            task = find(self);
+            if (task == nullptr && mStopping.load(std::memory_order_acquire)) {
+                mSleepers.fetch_sub(1, std::memory_order_relaxed);
+                return;
+            }
+            if (task == nullptr)
+                mEpoch.wait(epoch, std::memory_order_acquire);
+            mSleepers.fetch_sub(1, std::memory_order_relaxed);
+            if (task)
+                execute(task);
+        }
+    }
+
+} // ysh
@@ -0,0 +1,297 @@
+/*
+ * ThreadPool.h Created by Richard Buckley (C) 19/10/26
+ */
+
+/**
+ * @file ThreadPool.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 19/10/26
+ * @brief A work stealing thread pool.
+ * @details Each worker owns a Chase-Lev deque. A worker pushes and takes tasks at the bottom of its own deque
+ * and idle workers steal from the top of the others, so tasks spawned by a task usually run on the same
+ * thread while their data is still in cache. Tasks submitted from outside the pool enter through an
+ * MpmcChannel. Workers that find nothing to do spin briefly, then park in std::atomic::wait until work is
+ * scheduled. The pool is sized from the CPU affinity mask of the process.
+ */
+
+#ifndef VE3YSH_UTIL_THREADPOOL_H
+#define VE3YSH_UTIL_THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <ranges>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <Channel.h>
+
+namespace ysh {
+
+    namespace pool {
+
+        /**
+         * @struct Task
+         * @brief A unit of work, allocated when scheduled and deleted after it runs.
+         */
+        struct Task {
+            std::move_only_function<void()> body{};
+        };
+
+        /**
+         * @class WorkDeque
+         * @brief The Chase-Lev work stealing deque, with the memory orders of Lê et al. (PPoPP 2013).
+         * @details push() and take() may only be called by the owning thread, steal() by any thread. The ring
+         * doubles when full. Replaced rings are kept until the deque is destroyed because a thief may still
+         * be reading one.
+         */
+        class WorkDeque {
+        private:
+            struct Ring {
+                std::int64_t capacity;
+                std::unique_ptr<std::atomic<Task *>[]> slots;
+
+                explicit Ring(std::int64_t size)
+                        : capacity(size), slots(std::make_unique<std::atomic<Task *>[]>(static_cast<std::size_t>(size))) {}
+
+                [[nodiscard]] Task *get(std::int64_t idx) const {
+                    return slots[static_cast<std::size_t>(idx & (capacity - 1))].load(std::memory_order_relaxed);
+                }
+
+                void put(std::int64_t idx, Task *task) {
+                    slots[static_cast<std::size_t>(idx & (capacity - 1))].store(task, std::memory_order_relaxed);
+                }
+            };
+
+            alignas(channel::CacheLine) std::atomic<std::int64_t> mTop{0};
+            alignas(channel::CacheLine) std::atomic<std::int64_t> mBottom{0};
+            std::atomic<Ring *> mRing;
+            std::vector<std::unique_ptr<Ring>> mRings{};    ///< Every ring allocated, owner only.
+
+            Ring *grow(Ring *ring, std::int64_t top, std::int64_t bottom) {
+                auto &larger = mRings.emplace_back(std::make_unique<Ring>(ring->capacity * 2));
+                for (auto idx = top; idx < bottom; ++idx)
+                    larger->put(idx, ring->get(idx));
+                mRing.store(larger.get(), std::memory_order_release);
+                return larger.get();
+            }
+
+        public:
+            explicit WorkDeque(std::int64_t capacity = 256) {
+                mRings.push_back(std::make_unique<Ring>(capacity));
+                mRing.store(mRings.back().get(), std::memory_order_relaxed);
+            }
+
+            WorkDeque(const WorkDeque &) = delete;
+            WorkDeque &operator=(const WorkDeque &) = delete;
+
+            /**
+             * @brief Push a task at the bottom, owner only.
+             */
+            void push(Task *task) {
+                auto bottom = mBottom.load(std::memory_order_relaxed);
+                auto top = mTop.load(std::memory_order_acquire);
+                auto ring = mRing.load(std::memory_order_relaxed);
+                if (bottom - top > ring->capacity - 1)
+                    ring = grow(ring, top, bottom);
+                ring->put(bottom, task);
+                std::atomic_thread_fence(std::memory_order_release);
+                mBottom.store(bottom + 1, std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief Take the most recently pushed task, owner only.
+             * @return The task, or nullptr if the deque is empty.
+             */
+            Task *take() {
+                auto bottom = mBottom.load(std::memory_order_relaxed) - 1;
+                auto ring = mRing.load(std::memory_order_relaxed);
+                mBottom.store(bottom, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                auto top = mTop.load(std::memory_order_relaxed);
+                Task *task = nullptr;
+                if (top <= bottom) {
+                    task = ring->get(bottom);
+                    if (top == bottom) {    // The last task, race thieves for it.
+                        if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                                          std::memory_order_relaxed))
+                            task = nullptr;
+                        mBottom.store(bottom + 1, std::memory_order_relaxed);
+                    }
+                } else {
+                    mBottom.store(bottom + 1, std::memory_order_relaxed);
+                }
+                return task;
+            }
+
+            /**
+             * @brief Steal the least recently pushed task, any thread.
+             * @return The task, or nullptr if the deque is empty or another thread won the race.
+             */
+            Task *steal() {
+                auto top = mTop.load(std::memory_order_acquire);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                auto bottom = mBottom.load(std::memory_order_acquire);
+                if (top < bottom) {
+                    auto task = mRing.load(std::memory_order_acquire)->get(top);
+                    if (mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                                     std::memory_order_relaxed))
+                        return task;
+                }
+                return nullptr;
+            }
+        };
+
+    } // pool
+
+    /**
+     * @class ThreadPool
+     * @brief A fixed set of worker threads that run submitted tasks.
+     * @details Tasks scheduled from a worker go to that worker's deque, tasks scheduled from any other thread
+     * go to the shared injection channel, which blocks the submitter while it is full. Destroying the pool
+     * runs the tasks already scheduled and then joins the workers.
+     */
+    class ThreadPool {
+    private:
+        struct Worker {
+            pool::WorkDeque deque{};
+            std::thread thread{};
+        };
+
+        std::vector<std::unique_ptr<Worker>> mWorkers{};
+        MpmcChannel<pool::Task *> mInjection;
+        alignas(channel::CacheLine) std::atomic<std::uint32_t> mSleepers{0};
+        std::atomic<std::uint32_t> mEpoch{0};
+        std::atomic<bool> mStopping{false};
+
+        void schedule(pool::Task *task);
+
+        pool::Task *find(std::size_t self);
+
+        void run(std::size_t self);
+
+        void wake();
+
+        /**
+         * @brief The index of the calling thread in this pool, or size() if it is not a worker.
+         */
+        [[nodiscard]] std::size_t self() const;
+
+    public:
+        /**
+         * @brief Constructor.
+         * @param threads The number of workers, 0 for one per CPU in the affinity mask.
+         */
+        explicit ThreadPool(std::size_t threads = 0);
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        ~ThreadPool();
+
+        /**
+         * @brief The number of CPUs the process may run on, from sched_getaffinity(2).
+         */
+        static std::size_t affinityCount();
+
+        /**
+         * @brief The process wide pool the library runs its concurrent work on, created on first use.
+         */
+        static ThreadPool &instance();
+
+        [[nodiscard]] std::size_t size() const { return mWorkers.size(); }
+
+        /**
+         * @brief Schedule a callable and forget it. The callable must not throw.
+         */
+        template<class Callable>
+        void post(Callable &&callable) {
+            schedule(new pool::Task{std::forward<Callable>(callable)});
+        }
+
+        /**
+         * @brief Schedule a callable.
+         * @return A future for the result, or the exception the callable threw.
+         */
+        template<class Callable>
+        auto submit(Callable &&callable) -> std::future<std::invoke_result_t<std::decay_t<Callable>>> {
+            std::packaged_task<std::invoke_result_t<std::decay_t<Callable>>()> task{std::forward<Callable>(callable)};
+            auto future = task.get_future();
+            schedule(new pool::Task{std::move(task)});
+            return future;
+        }
+
+        /**
+         * @brief Call body(idx) for every idx in [begin, end), in parallel, and wait for all calls to return.
+         * @details The range is cut into chunks of grain indexes, by default four chunks per worker. Workers
+         * and the calling thread claim chunks in order until none are left, so the caller never waits on a
+         * chunk nobody has started. The first exception thrown by body is rethrown once all claimed chunks
+         * are finished, and chunks not yet started are skipped.
+         * @param grain The number of indexes per chunk, 0 to choose.
+         */
+        template<class Body>
+        void parallel_for(std::size_t begin, std::size_t end, Body &&body, std::size_t grain = 0) {
+            if (end <= begin)
+                return;
+            auto count = end - begin;
+            if (grain == 0)
+                grain = std::max<std::size_t>(1, count / (size() * 4));
+
+            struct State {
+                std::atomic<std::size_t> next{0};
+                std::atomic<std::size_t> done{0};
+                std::atomic<bool> failed{false};
+                std::exception_ptr error{};
+            };
+            auto state = std::make_shared<State>();
+            auto chunks = (count + grain - 1) / grain;
+
+            auto work = [state, chunks, begin, end, grain, bodyPtr = &body]() {
+                for (auto chunk = state->next.fetch_add(1, std::memory_order_relaxed); chunk < chunks;
+                     chunk = state->next.fetch_add(1, std::memory_order_relaxed)) {
+                    if (!state->failed.load(std::memory_order_relaxed)) {
+                        try {
+                            auto first = begin + chunk * grain;
+                            for (auto idx = first, last = std::min(first + grain, end); idx < last; ++idx)
+                                (*bodyPtr)(idx);
+                        } catch (...) {
+                            if (!state->failed.exchange(true, std::memory_order_relaxed))
+                                state->error = std::current_exception();
+                        }
+                    }
+                    if (state->done.fetch_add(1, std::memory_order_acq_rel) + 1 == chunks)
+                        state->done.notify_all();
+                }
+            };
+
+            for (std::size_t helper = 0, helpers = std::min(size(), chunks - 1); helper < helpers; ++helper)
+                post(work);
+            work();
+            for (auto done = state->done.load(std::memory_order_acquire); done != chunks;
+                 done = state->done.load(std::memory_order_acquire))
+                state->done.wait(done, std::memory_order_acquire);
+            if (state->error)
+                std::rethrow_exception(state->error);
+        }
+
+        /**
+         * @brief Call body(element) for every element of a random access range, in parallel.
+         */
+        template<std::ranges::random_access_range Range, class Body>
+        void parallel_for(Range &&range, Body &&body, std::size_t grain = 0) {
+            auto first = std::ranges::begin(range);
+            parallel_for(0, static_cast<std::size_t>(std::ranges::size(range)), [&first, &body](std::size_t idx) {
+                body(first[static_cast<std::ranges::range_difference_t<Range>>(idx)]);
+            }, grain);
+        }
+    };
+
+} // ysh
+
+#endif //VE3YSH_UTIL_THREADPOOL_H